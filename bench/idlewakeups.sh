@@ -0,0 +1,65 @@
+#!/bin/sh
+# Idle power self-test: runs qmpanel with PowerMode=idle on a private
+# Xvfb server and session bus, leaves it idle, and counts its event loop
+# wakeups (as reported by --stats). Fails if there are more than
+# expected per minute. Context switches of all the panel's threads
+# (including Qt's helper threads) are printed too, but not checked.
+#
+# Usage: bench/idlewakeups.sh [build dir] [seconds] [max per minute]
+
+set -e
+
+build=${1:-build}
+seconds=${2:-60}
+max=${3:-3}
+display=:${XVFB_DISPLAY:-98}
+
+config=$(mktemp -d)
+printf '[Settings]\nPowerMode=idle\n' > "$config/qmpanel.ini"
+
+Xvfb "$display" -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $panel $xvfb $DBUS_SESSION_BUS_PID 2>/dev/null; rm -rf "$config"' \
+    EXIT
+
+export DISPLAY="$display"
+export QT_QPA_PLATFORM=xcb
+export XDG_CONFIG_HOME="$config"
+eval "$(dbus-launch --sh-syntax)"
+sleep 1
+
+"$build/qmpanel" &
+panel=$!
+sleep 5 # let startup settle
+
+# context switches of all threads of the panel
+switches() {
+    cat /proc/$panel/task/*/status |
+        awk '/ctxt_switches/ { total += $2 } END { print total }'
+}
+
+loop_wakeups() {
+    "$build/qmpanel" --stats | awk '$1 == "panel.wakeups" { print $2 }'
+}
+
+# each --stats wakes the panel too; two calls in a row tell how often
+start_loop=$(loop_wakeups)
+calibrate=$(loop_wakeups)
+start=$(switches)
+sleep "$seconds"
+end=$(switches)
+end_loop=$(loop_wakeups)
+
+per_call=$(( calibrate - start_loop ))
+wakeups=$(( end_loop - calibrate - per_call ))
+
+echo "idle.seconds $seconds"
+echo "idle.context_switches_per_minute $(( (end - start) * 60 / seconds ))"
+echo "idle.event_loop_wakeups $wakeups"
+
+if [ $(( wakeups * 60 )) -gt $(( max * seconds )) ]; then
+    echo "FAIL: more than $max event loop wakeups per minute while idle"
+    exit 1
+fi
+
+echo "PASS"
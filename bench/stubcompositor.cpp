@@ -0,0 +1,244 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "stubcompositor.h"
+#include "wlr-foreign-toplevel-management-unstable-v1-server.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <wayland-server.h>
+
+struct Compositor
+{
+    wl_display * display = nullptr;
+    wl_event_loop * loop = nullptr;
+    std::vector<wl_resource *> managers;
+    std::vector<wl_resource *> toplevels; // null once destroyed
+};
+
+uint64_t monotonicNsecs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const zwlr_foreign_toplevel_handle_v1_interface handle_impl = {
+    .set_maximized = [](wl_client *, wl_resource *) {},
+    .unset_maximized = [](wl_client *, wl_resource *) {},
+    .set_minimized = [](wl_client *, wl_resource *) {},
+    .unset_minimized = [](wl_client *, wl_resource *) {},
+    .activate = [](wl_client *, wl_resource *, wl_resource *) {},
+    .close = [](wl_client *, wl_resource *) {},
+    .set_rectangle = [](wl_client *, wl_resource *, wl_resource *, int32_t,
+                        int32_t, int32_t, int32_t) {},
+    .destroy = [](wl_client *,
+                  wl_resource * resource) { wl_resource_destroy(resource); },
+    .set_fullscreen = [](wl_client *, wl_resource *, wl_resource *) {},
+    .unset_fullscreen = [](wl_client *, wl_resource *) {},
+};
+
+static const zwlr_foreign_toplevel_manager_v1_interface manager_impl = {
+    .stop =
+        [](wl_client *, wl_resource * resource) {
+            zwlr_foreign_toplevel_manager_v1_send_finished(resource);
+            wl_resource_destroy(resource);
+        },
+};
+
+static void bindManager(wl_client * client, void * data, uint32_t version,
+                        uint32_t id)
+{
+    auto comp = static_cast<Compositor *>(data);
+    auto resource = wl_resource_create(
+        client, &zwlr_foreign_toplevel_manager_v1_interface, version, id);
+
+    wl_resource_set_implementation(
+        resource, &manager_impl, comp, [](wl_resource * resource) {
+            auto comp =
+                static_cast<Compositor *>(wl_resource_get_user_data(resource));
+            auto & managers = comp->managers;
+            managers.erase(
+                std::remove(managers.begin(), managers.end(), resource),
+                managers.end());
+        });
+
+    comp->managers.push_back(resource);
+}
+
+// Dispatches client requests for (at most) the given time
+static void run(Compositor & comp, int msecs)
+{
+    uint64_t end = monotonicNsecs() + (uint64_t)msecs * 1000000;
+    uint64_t now;
+
+    do
+    {
+        wl_display_flush_clients(comp.display);
+        now = monotonicNsecs();
+        int wait = (now < end) ? (int)((end - now) / 1000000) : 0;
+        wl_event_loop_dispatch(comp.loop, wait);
+    } while (monotonicNsecs() < end);
+
+    wl_display_flush_clients(comp.display);
+}
+
+static void sendTitle(wl_resource * handle, int index, int round)
+{
+    auto title = "Window " + std::to_string(index) + " round " +
+                 std::to_string(round) + " @" +
+                 std::to_string(monotonicNsecs());
+    zwlr_foreign_toplevel_handle_v1_send_title(handle, title.c_str());
+}
+
+static void sendState(wl_resource * handle, bool active)
+{
+    wl_array states;
+    wl_array_init(&states);
+
+    if (active)
+    {
+        auto state = static_cast<uint32_t *>(
+            wl_array_add(&states, sizeof(uint32_t)));
+        *state = ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_ACTIVATED;
+    }
+
+    zwlr_foreign_toplevel_handle_v1_send_state(handle, &states);
+    wl_array_release(&states);
+}
+
+int runStubCompositor(const char * socket, int readyFd, int count,
+                      int rounds)
+{
+    Compositor comp;
+    comp.display = wl_display_create();
+    comp.loop = wl_display_get_event_loop(comp.display);
+
+    if (wl_display_add_socket(comp.display, socket) < 0)
+    {
+        fprintf(stderr, "Could not create Wayland socket %s\n", socket);
+        return 1;
+    }
+
+    wl_global_create(comp.display, &zwlr_foreign_toplevel_manager_v1_interface,
+                     3, &comp, bindManager);
+
+    (void)!write(readyFd, "", 1);
+    close(readyFd);
+
+    while (comp.managers.empty())
+        run(comp, 100);
+
+    auto manager = comp.managers[0];
+    auto client = wl_resource_get_client(manager);
+    int version = wl_resource_get_version(manager);
+
+    // create toplevels, yielding to the client now and then
+    for (int i = 0; i < count; i++)
+    {
+        auto handle = wl_resource_create(
+            client, &zwlr_foreign_toplevel_handle_v1_interface, version, 0);
+
+        wl_resource_set_implementation(
+            handle, &handle_impl, &comp, [](wl_resource * resource) {
+                auto comp = static_cast<Compositor *>(
+                    wl_resource_get_user_data(resource));
+                std::replace(comp->toplevels.begin(), comp->toplevels.end(),
+                             resource, (wl_resource *)nullptr);
+            });
+
+        zwlr_foreign_toplevel_manager_v1_send_toplevel(manager, handle);
+        sendTitle(handle, i, 0);
+        auto appId = "org.example.App" + std::to_string(i % 10);
+        zwlr_foreign_toplevel_handle_v1_send_app_id(handle, appId.c_str());
+        sendState(handle, false);
+        zwlr_foreign_toplevel_handle_v1_send_done(handle);
+        comp.toplevels.push_back(handle);
+
+        if (i % 50 == 49)
+            run(comp, 0);
+    }
+
+    run(comp, 500);
+
+    // title storm: every toplevel changes its title once per frame
+    for (int round = 1; round <= rounds; round++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (auto handle = comp.toplevels[i])
+            {
+                sendTitle(handle, i, round);
+                zwlr_foreign_toplevel_handle_v1_send_done(handle);
+            }
+        }
+
+        run(comp, 16);
+    }
+
+    run(comp, 500);
+
+    // state storm: the active toplevel changes once per frame
+    for (int round = 0; round < rounds && count > 0; round++)
+    {
+        auto previous = comp.toplevels[(round + count - 1) % count];
+        auto active = comp.toplevels[round % count];
+
+        if (previous && previous != active)
+        {
+            sendState(previous, false);
+            zwlr_foreign_toplevel_handle_v1_send_done(previous);
+        }
+        if (active)
+        {
+            sendTitle(active, round % count, rounds + round);
+            sendState(active, true);
+            zwlr_foreign_toplevel_handle_v1_send_done(active);
+        }
+
+        run(comp, 16);
+    }
+
+    run(comp, 500);
+
+    for (auto handle : comp.toplevels)
+    {
+        if (handle)
+            zwlr_foreign_toplevel_handle_v1_send_closed(handle);
+    }
+
+    // wait (up to 10 seconds) for the client to finish and disconnect
+    for (int i = 0; i < 100 && !comp.managers.empty(); i++)
+        run(comp, 100);
+
+    wl_display_destroy_clients(comp.display);
+    wl_display_destroy(comp.display);
+    return 0;
+}
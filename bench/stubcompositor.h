@@ -0,0 +1,43 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef STUBCOMPOSITOR_H
+#define STUBCOMPOSITOR_H
+
+#include <stdint.h>
+
+// Minimal Wayland server offering only zwlr_foreign_toplevel_manager_v1.
+// Once a client binds the manager, it creates "count" toplevels, sends
+// "rounds" title changes to each of them, then "rounds" changes of the
+// active toplevel, and finally closes all of them. Titles end with
+// "@<CLOCK_MONOTONIC nanoseconds>" at the time they were sent.
+// Writes a byte to readyFd once the socket exists.
+int runStubCompositor(const char * socket, int readyFd, int count,
+                      int rounds);
+
+uint64_t monotonicNsecs();
+
+#endif // STUBCOMPOSITOR_H
@@ -0,0 +1,210 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+// Benchmark for the Wayland taskbar. A stub compositor (in a child
+// process) creates toplevels and sends title and state storms to a panel
+// running in this process on Qt's offscreen platform.
+//
+// Usage: waylandstorm [toplevels] [rounds]
+
+#include "mainpanel.h"
+#include "resources.h"
+#include "stubcompositor.h"
+#include "taskbutton.h"
+#include "taskmodel.h"
+
+#include <QApplication>
+#include <algorithm>
+#include <optional>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include <wayland-client.h>
+
+// normally in main.cpp, used by resources.cpp
+void restore_signals(void *) {}
+
+// Measures the time from the compositor sending a title to the panel
+// first painting it
+class PaintFilter : public QObject
+{
+public:
+    std::vector<double> latencies; // ms
+
+protected:
+    bool eventFilter(QObject * object, QEvent * event) override
+    {
+        if (event->type() != QEvent::Paint)
+            return false;
+
+        auto button = dynamic_cast<TaskButton *>(object);
+        if (!button)
+            return false;
+
+        auto & title = button->title();
+        auto & last = mLastTitles[button];
+        int at = title.lastIndexOf('@');
+
+        if (at >= 0 && title != last)
+        {
+            uint64_t sent = title.mid(at + 1).toULongLong();
+            latencies.push_back((monotonicNsecs() - sent) / 1e6);
+            last = title;
+        }
+
+        return false;
+    }
+
+private:
+    std::unordered_map<TaskButton *, QString> mLastTitles;
+};
+
+static long readStatusKiB(const char * field)
+{
+    FILE * file = fopen("/proc/self/status", "r");
+    if (!file)
+        return 0;
+
+    char line[256];
+    long value = 0;
+    size_t len = strlen(field);
+
+    while (fgets(line, sizeof line, file))
+    {
+        if (!strncmp(line, field, len) && line[len] == ':')
+            value = atol(line + len + 1);
+    }
+
+    fclose(file);
+    return value;
+}
+
+static double percentile(std::vector<double> & values, double p)
+{
+    if (values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+int main(int argc, char * argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 100;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 50;
+    auto socket = QByteArray("qmpanel-bench-") + QByteArray::number(getpid());
+
+    int fds[2];
+    if (pipe(fds) < 0)
+        return 1;
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(fds[0]);
+        _exit(runStubCompositor(socket, fds[1], count, rounds));
+    }
+
+    char ready;
+    close(fds[1]);
+    if (read(fds[0], &ready, 1) != 1)
+        return 1;
+    close(fds[0]);
+
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    auto display = wl_display_connect(socket);
+    if (!display)
+    {
+        fprintf(stderr, "Could not connect to %s\n", socket.constData());
+        return 1;
+    }
+
+    PaintFilter filter;
+    app.installEventFilter(&filter);
+
+    std::optional<Resources> res;
+    std::optional<TaskModel> tasks;
+    std::optional<MainPanel> panel;
+    res.emplace();
+    tasks.emplace(*res, display);
+    panel.emplace(*res, *tasks);
+
+    long baseKiB = readStatusKiB("VmRSS");
+    long fullKiB = 0;
+    bool filled = false;
+
+    // quit once all toplevels have been added and closed again
+    tasks->addListener({
+        [&](TaskModel::Id) {
+            if (!filled && (int)tasks->ids().size() == count)
+            {
+                filled = true;
+                fullKiB = readStatusKiB("VmRSS");
+            }
+        },
+        [&](TaskModel::Id) {
+            if (filled && tasks->ids().size() == 1)
+                QMetaObject::invokeMethod(&app, &QApplication::quit,
+                                          Qt::QueuedConnection);
+        },
+        [](TaskModel::Id, int) {},
+    });
+
+    app.exec();
+
+    auto stats = panel->stats();
+    panel.reset();
+    tasks.reset();
+    res.reset();
+    wl_display_disconnect(display);
+    waitpid(child, nullptr, 0);
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto & lat = filter.latencies;
+
+    printf("toplevels: %d, rounds: %d\n", count, rounds);
+    printf("cpu: %.1f ms user, %.1f ms system\n",
+           usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3,
+           usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3);
+    printf("memory: %.1f KiB per toplevel (VmRSS %ld -> %ld KiB), "
+           "peak %ld KiB\n",
+           count ? (fullKiB - baseKiB) / (double)count : 0.0, baseKiB,
+           fullKiB, readStatusKiB("VmHWM"));
+    printf("title-to-paint latency (%zu samples): p50 %.2f ms, "
+           "p95 %.2f ms, max %.2f ms\n",
+           lat.size(), percentile(lat, 0.5), percentile(lat, 0.95),
+           percentile(lat, 1.0));
+    printf("%s", stats.toUtf8().constData());
+
+    return 0;
+}
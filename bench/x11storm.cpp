@@ -0,0 +1,245 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+// Window storm generator for the X11 taskbar benchmark (see x11storm.sh).
+// Stands in for a window manager on an otherwise empty X server: creates
+// and maps windows, lists them in _NET_CLIENT_LIST, then changes their
+// _NET_WM_NAME (every frame), _NET_WM_ICON (every 4th frame) and the
+// _NET_ACTIVE_WINDOW (every frame). Prints the number of events sent.
+//
+// Usage: x11storm [windows] [rounds]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+#include <xcb/xcb.h>
+
+enum Atom
+{
+    NET_SUPPORTING_WM_CHECK,
+    NET_CLIENT_LIST,
+    NET_CLIENT_LIST_STACKING,
+    NET_ACTIVE_WINDOW,
+    NET_WM_NAME,
+    NET_WM_ICON,
+    NET_WM_WINDOW_TYPE,
+    NET_WM_WINDOW_TYPE_NORMAL,
+    UTF8_STRING,
+    ATOM_COUNT
+};
+
+static const char * const atomNames[ATOM_COUNT] = {
+    "_NET_SUPPORTING_WM_CHECK",
+    "_NET_CLIENT_LIST",
+    "_NET_CLIENT_LIST_STACKING",
+    "_NET_ACTIVE_WINDOW",
+    "_NET_WM_NAME",
+    "_NET_WM_ICON",
+    "_NET_WM_WINDOW_TYPE",
+    "_NET_WM_WINDOW_TYPE_NORMAL",
+    "UTF8_STRING"};
+
+static xcb_connection_t * conn;
+static xcb_window_t root;
+static xcb_atom_t atoms[ATOM_COUNT];
+
+static void internAtoms()
+{
+    xcb_intern_atom_cookie_t cookies[ATOM_COUNT];
+    for (int i = 0; i < ATOM_COUNT; i++)
+    {
+        cookies[i] =
+            xcb_intern_atom(conn, false, strlen(atomNames[i]), atomNames[i]);
+    }
+
+    for (int i = 0; i < ATOM_COUNT; i++)
+    {
+        auto reply = xcb_intern_atom_reply(conn, cookies[i], nullptr);
+        atoms[i] = reply ? reply->atom : (xcb_atom_t)XCB_ATOM_NONE;
+        free(reply);
+    }
+}
+
+static void setProperty(xcb_window_t window, xcb_atom_t property,
+                        xcb_atom_t type, int format, uint32_t length,
+                        const void * data)
+{
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, property, type,
+                        format, length, data);
+}
+
+static void setTitle(xcb_window_t window, int index, int round)
+{
+    auto title = "Window " + std::to_string(index) + " round " +
+                 std::to_string(round);
+    setProperty(window, atoms[NET_WM_NAME], atoms[UTF8_STRING], 8,
+                title.size(), title.data());
+}
+
+// 16x16 and 32x32 images in one solid color
+static void setIcon(xcb_window_t window, uint32_t argb)
+{
+    std::vector<uint32_t> data;
+    for (uint32_t size : {16, 32})
+    {
+        data.push_back(size);
+        data.push_back(size);
+        data.insert(data.end(), size * size, argb);
+    }
+
+    setProperty(window, atoms[NET_WM_ICON], XCB_ATOM_CARDINAL, 32,
+                data.size(), data.data());
+}
+
+static void setWindowList(const std::vector<xcb_window_t> & windows)
+{
+    for (int list : {NET_CLIENT_LIST, NET_CLIENT_LIST_STACKING})
+    {
+        setProperty(root, atoms[list], XCB_ATOM_WINDOW, 32, windows.size(),
+                    windows.data());
+    }
+}
+
+static void setActive(xcb_window_t window)
+{
+    setProperty(root, atoms[NET_ACTIVE_WINDOW], XCB_ATOM_WINDOW, 32, 1,
+                &window);
+}
+
+// waits until the next 16 ms frame, after the server has processed
+// everything sent so far
+static void nextFrame(timespec & frame)
+{
+    free(xcb_get_input_focus_reply(conn, xcb_get_input_focus(conn), nullptr));
+
+    frame.tv_nsec += 16000000;
+    if (frame.tv_nsec >= 1000000000)
+    {
+        frame.tv_sec++;
+        frame.tv_nsec -= 1000000000;
+    }
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &frame, nullptr);
+}
+
+int main(int argc, char * argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 300;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 100;
+
+    conn = xcb_connect(nullptr, nullptr);
+    if (xcb_connection_has_error(conn))
+    {
+        fprintf(stderr, "Could not connect to X server\n");
+        return 1;
+    }
+
+    root = xcb_setup_roots_iterator(xcb_get_setup(conn)).data->root;
+    internAtoms();
+
+    // advertise a (fake) EWMH-compliant window manager
+    xcb_window_t check = xcb_generate_id(conn);
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, check, root, 0, 0, 1, 1, 0,
+                      XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, 0,
+                      nullptr);
+    setProperty(check, atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32,
+                1, &check);
+    setProperty(root, atoms[NET_SUPPORTING_WM_CHECK], XCB_ATOM_WINDOW, 32, 1,
+                &check);
+
+    timespec frame;
+    clock_gettime(CLOCK_MONOTONIC, &frame);
+    long events = 0;
+
+    // windows are added in batches of 10 per frame
+    std::vector<xcb_window_t> windows;
+    for (int i = 0; i < count; i++)
+    {
+        xcb_window_t window = xcb_generate_id(conn);
+        xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, root,
+                          (i % 40) * 20, (i % 30) * 20, 200, 100, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, 0, nullptr);
+
+        setProperty(window, atoms[NET_WM_WINDOW_TYPE], XCB_ATOM_ATOM, 32, 1,
+                    &atoms[NET_WM_WINDOW_TYPE_NORMAL]);
+        setProperty(window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 8, 14,
+                    "x11storm\0Storm");
+        setTitle(window, i, 0);
+        setIcon(window, 0xff000000 | (i * 0x10101));
+        xcb_map_window(conn, window);
+        windows.push_back(window);
+
+        if (i % 10 == 9 || i == count - 1)
+        {
+            setWindowList(windows);
+            events++;
+            nextFrame(frame);
+        }
+    }
+
+    for (int r = 1; r <= rounds; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            setTitle(windows[i], i, r);
+            events++;
+
+            if (r % 4 == 0)
+            {
+                setIcon(windows[i], 0xff000000 | ((i + r) * 0x10101));
+                events++;
+            }
+        }
+
+        if (count > 0)
+        {
+            setActive(windows[r % count]);
+            events++;
+        }
+        nextFrame(frame);
+    }
+
+    // close all windows at once
+    setActive(XCB_WINDOW_NONE);
+    setWindowList({});
+    for (xcb_window_t window : windows)
+        xcb_destroy_window(conn, window);
+    events += 2;
+
+    xcb_destroy_window(conn, check);
+    nextFrame(frame);
+    xcb_disconnect(conn);
+
+    printf("generator.windows %d\n", count);
+    printf("generator.rounds %d\n", rounds);
+    printf("generator.events %ld\n", events);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# X11 taskbar benchmark: runs qmpanel and the x11storm generator on a
+# private Xvfb server and session bus, then prints the panel's CPU time
+# and performance counters.
+#
+# Usage: bench/x11storm.sh [build dir] [windows] [rounds]
+#
+# The panel's own X11 event handling is used by default, since it
+# counts every round trip; set QMPANEL_X11_EVENTS= to use KWindowSystem.
+
+set -e
+
+build=${1:-build}
+windows=${2:-300}
+rounds=${3:-100}
+display=:${XVFB_DISPLAY:-97}
+
+Xvfb "$display" -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $panel $xvfb $DBUS_SESSION_BUS_PID 2>/dev/null' EXIT
+
+export DISPLAY="$display"
+export QT_QPA_PLATFORM=xcb
+export QMPANEL_X11_EVENTS=${QMPANEL_X11_EVENTS-xcb}
+eval "$(dbus-launch --sh-syntax)"
+sleep 1
+
+"$build/qmpanel" &
+panel=$!
+sleep 2
+
+# CPU time (utime + stime, in clock ticks) of the panel so far
+cpu_ticks() { awk '{print $14 + $15}' "/proc/$panel/stat"; }
+
+start=$(cpu_ticks)
+generator=$("$build/x11storm" "$windows" "$rounds")
+sleep 1
+end=$(cpu_ticks)
+stats=$("$build/qmpanel" --stats)
+
+echo "$generator"
+echo "panel.cpu_msecs $(( (end - start) * 1000 / $(getconf CLK_TCK) ))"
+echo "$stats"
+
+# round trips include those made at startup, before the storm
+printf '%s\n%s\n' "$generator" "$stats" | awk '
+    $1 == "generator.events" { events = $2 }
+    $1 == "x11.round_trips" { trips = $2 }
+    END {
+        if (events)
+            printf "x11.round_trips_per_event %.3f\n", trips / events
+    }'
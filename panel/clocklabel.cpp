@@ -30,11 +30,247 @@
 #include "clocklabel.h"
 #include "mainpanel.h"
 
+#include <QCalendarWidget>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimerEvent>
+#include <QWidgetAction>
+#include <errno.h>
+#include <functional>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static const char * const localTimeFile = "/etc/localtime";
+
+static QString zoneKey()
+{
+    QFileInfo info(localTimeFile);
+    return info.canonicalFilePath() + '@' +
+           QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+// Tells the clocks of all panels when the minute or the time zone
+// changes, so that there is only one timer and one watch to wake up.
+class ClockSource : public QObject
+{
+public:
+    ClockSource();
+    ~ClockSource();
+
+    static std::shared_ptr<ClockSource> get();
+
+    int addListener(std::function<void()> listener);
+    void removeListener(int handle);
+
+protected:
+    void timerEvent(QTimerEvent *) override;
+
+private:
+    void armTimer();
+    void readTimer();
+    void watchZone();
+    void readZone();
+    void notify();
+
+    int mTimerFd = -1; // timerfd, or a Qt timer if not available
+    std::unique_ptr<QSocketNotifier> mTimerNotifier;
+    int mTimerId = 0;
+
+    int mZoneFd = -1; // inotify
+    std::unique_ptr<QSocketNotifier> mZoneNotifier;
+    int mZoneWatch = -1; // /etc/localtime itself
+    int mDirWatch = -1;  // /etc, only while /etc/localtime is missing
+    QString mZoneKey;    // link target and mtime of the zone
+
+    std::vector<std::pair<int, std::function<void()>>> mListeners;
+    int mNextListener = 0;
+};
+
+ClockSource::ClockSource()
+{
+    mTimerFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (mTimerFd >= 0)
+    {
+        mTimerNotifier.reset(
+            new QSocketNotifier(mTimerFd, QSocketNotifier::Read));
+        connect(mTimerNotifier.get(), &QSocketNotifier::activated, this,
+                &ClockSource::readTimer);
+    }
+
+    armTimer();
+
+    mZoneKey = zoneKey();
+    mZoneFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mZoneFd >= 0)
+    {
+        mZoneNotifier.reset(
+            new QSocketNotifier(mZoneFd, QSocketNotifier::Read));
+        connect(mZoneNotifier.get(), &QSocketNotifier::activated, this,
+                &ClockSource::readZone);
+        watchZone();
+    }
+}
+
+ClockSource::~ClockSource()
+{
+    mTimerNotifier.reset();
+    if (mTimerFd >= 0)
+        close(mTimerFd);
+
+    mZoneNotifier.reset();
+    if (mZoneFd >= 0)
+        close(mZoneFd);
+}
+
+// created by the first clock and deleted with the last one
+std::shared_ptr<ClockSource> ClockSource::get()
+{
+    static std::weak_ptr<ClockSource> shared;
+    auto source = shared.lock();
+    if (!source)
+    {
+        source = std::make_shared<ClockSource>();
+        shared = source;
+    }
+    return source;
+}
+
+int ClockSource::addListener(std::function<void()> listener)
+{
+    mListeners.emplace_back(mNextListener, std::move(listener));
+    return mNextListener++;
+}
+
+void ClockSource::removeListener(int handle)
+{
+    for (auto it = mListeners.begin(); it != mListeners.end(); ++it)
+    {
+        if (it->first == handle)
+        {
+            mListeners.erase(it);
+            break;
+        }
+    }
+}
+
+void ClockSource::notify()
+{
+    for (auto & pair : mListeners)
+        pair.second();
+}
+
+// The timer fires every minute, exactly when the minute changes. If the
+// realtime clock is set (by NTP, by hand, or after resuming), the kernel
+// cancels the timer, and the clocks are updated and the timer re-aligned.
+void ClockSource::armTimer()
+{
+    if (mTimerFd < 0)
+    {
+        // fallback: the timer is precise as far as Qt is concerned (a
+        // coarse timer may fire early, before the minute has changed)
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        mTimerId = startTimer(60000 - now % 60000, Qt::PreciseTimer);
+        return;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = now.tv_sec - now.tv_sec % 60 + 60;
+    spec.it_interval.tv_sec = 60;
+
+    timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                    &spec, nullptr);
+}
+
+void ClockSource::readTimer()
+{
+    quint64 expirations;
+    if (read(mTimerFd, &expirations, sizeof expirations) < 0 &&
+        errno == ECANCELED)
+    {
+        armTimer(); // clock was set
+    }
+
+    notify();
+}
+
+void ClockSource::timerEvent(QTimerEvent *)
+{
+    killTimer(mTimerId);
+    armTimer();
+    notify();
+}
+
+// /etc/localtime is normally a symlink into /usr/share/zoneinfo, which
+// is replaced (not modified) when the zone is changed; so the link itself
+// is watched, and again after it is replaced. While it is missing (e.g.
+// between the unlink and symlink of "ln -sf"), files created in /etc are
+// watched for instead, but not writes to the files already there.
+void ClockSource::watchZone()
+{
+    mZoneWatch = inotify_add_watch(mZoneFd, localTimeFile,
+                                   IN_DONT_FOLLOW | IN_MODIFY | IN_ATTRIB |
+                                       IN_DELETE_SELF | IN_MOVE_SELF);
+
+    if (mZoneWatch >= 0 && mDirWatch >= 0)
+    {
+        inotify_rm_watch(mZoneFd, mDirWatch);
+        mDirWatch = -1;
+    }
+    else if (mZoneWatch < 0 && mDirWatch < 0)
+    {
+        mDirWatch = inotify_add_watch(mZoneFd, "/etc",
+                                      IN_ONLYDIR | IN_CREATE | IN_MOVED_TO);
+    }
+}
+
+void ClockSource::readZone()
+{
+    alignas(inotify_event) char buf[4096];
+    bool replaced = false;
+    ssize_t len;
+
+    while ((len = read(mZoneFd, buf, sizeof buf)) > 0)
+    {
+        for (ssize_t pos = 0; pos < len;)
+        {
+            auto event = reinterpret_cast<const inotify_event *>(buf + pos);
+            if (event->wd == mZoneWatch &&
+                (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)))
+            {
+                replaced = true;
+            }
+            pos += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    if (replaced)
+    {
+        inotify_rm_watch(mZoneFd, mZoneWatch); // if not already gone
+        mZoneWatch = -1;
+    }
+
+    if (mZoneWatch < 0)
+        watchZone();
+
+    auto key = zoneKey();
+    if (key == mZoneKey)
+        return;
+
+    mZoneKey = key;
+    tzset(); // re-read the zone before formatting
+    notify();
+}
+
 ClockLabel::ClockLabel(MainPanel * panel)
-    : QToolButton(panel), mMenu(this), mCalendarAction(this)
+    : QToolButton(panel), mSource(ClockSource::get()), mMenu(this)
 {
-    mCalendarAction.setDefaultWidget(&mCalendar);
-    mMenu.addAction(&mCalendarAction);
     panel->registerMenu(&mMenu);
 
     setAutoRaise(true);
@@ -42,14 +278,38 @@ ClockLabel::ClockLabel(MainPanel * panel)
     setPopupMode(InstantPopup);
     setStyleSheet("QToolButton::menu-indicator { image: none; }");
 
-    startTimer(10000);
-    timerEvent(nullptr);
+    mListener = mSource->addListener([this]() { updateText(); });
+    updateText();
 
-    connect(&mMenu, &QMenu::aboutToShow,
-            [this]() { mCalendar.setSelectedDate(QDate::currentDate()); });
+    connect(&mMenu, &QMenu::aboutToShow, [this]() {
+        createCalendar();
+        mCalendar->setSelectedDate(QDate::currentDate());
+    });
+}
+
+ClockLabel::~ClockLabel() { mSource->removeListener(mListener); }
+
+// QCalendarWidget is fairly heavy (a table view, a model and locale
+// data) and most sessions never open it. It is created when the mouse
+// first enters the clock, usually well before the click that opens it.
+void ClockLabel::createCalendar()
+{
+    if (mCalendar)
+        return;
+
+    mCalendar = new QCalendarWidget;
+    auto action = new QWidgetAction(&mMenu);
+    action->setDefaultWidget(mCalendar); // takes ownership
+    mMenu.addAction(action);
+}
+
+void ClockLabel::enterEvent(QEnterEvent * event)
+{
+    createCalendar();
+    QToolButton::enterEvent(event);
 }
 
-void ClockLabel::timerEvent(QTimerEvent *)
+void ClockLabel::updateText()
 {
     setText(QDateTime::currentDateTime().toString("ddd MMM d, h:mm a"));
 }
@@ -30,25 +30,32 @@
 #ifndef CLOCKLABEL_H
 #define CLOCKLABEL_H
 
-#include <QCalendarWidget>
 #include <QMenu>
 #include <QToolButton>
-#include <QWidgetAction>
+#include <memory>
 
+class ClockSource;
 class MainPanel;
+class QCalendarWidget;
 
+// Shows the time, updated once per minute, and a calendar when clicked
 class ClockLabel : public QToolButton
 {
 public:
     explicit ClockLabel(MainPanel * panel);
+    ~ClockLabel();
 
 protected:
-    void timerEvent(QTimerEvent *) override;
+    void enterEvent(QEnterEvent * event) override;
 
 private:
+    void createCalendar();
+    void updateText();
+
+    std::shared_ptr<ClockSource> mSource; // shared by all panels
+    int mListener;
     QMenu mMenu;
-    QWidgetAction mCalendarAction;
-    QCalendarWidget mCalendar;
+    QCalendarWidget * mCalendar = nullptr; // created when first needed
 };
 
 #endif // CLOCKLABEL_H
@@ -0,0 +1,51 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "elidedtext.h"
+
+#include <QFontMetrics>
+#include <QTransform>
+
+quint64 ElidedText::sLayoutCount = 0;
+
+const QStaticText & ElidedText::get(const QString & text, int width,
+                                    const QFont & font)
+{
+    if (width != mWidth || text != mText || font != mFont)
+    {
+        mText = text;
+        mWidth = width;
+        mFont = font;
+
+        QFontMetrics metrics(font);
+        mStaticText.setTextFormat(Qt::PlainText);
+        mStaticText.setText(metrics.elidedText(text, Qt::ElideRight, width));
+        mStaticText.prepare(QTransform(), font);
+        sLayoutCount++;
+    }
+
+    return mStaticText;
+}
@@ -0,0 +1,53 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef ELIDEDTEXT_H
+#define ELIDEDTEXT_H
+
+#include <QFont>
+#include <QStaticText>
+
+// Elided and laid out form of a string, kept between paint events and
+// recomputed only when the string, available width or font changes.
+class ElidedText
+{
+public:
+    const QStaticText & get(const QString & text, int width,
+                            const QFont & font);
+
+    // number of times any text was elided and laid out, for --stats
+    static quint64 layoutCount() { return sLayoutCount; }
+
+private:
+    static quint64 sLayoutCount;
+
+    QString mText;
+    int mWidth = -1;
+    QFont mFont;
+    QStaticText mStaticText;
+};
+
+#endif // ELIDEDTEXT_H
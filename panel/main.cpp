@@ -26,14 +26,22 @@
  *
  * END_COMMON_COPYRIGHT_HEADER */
 
-#include "mainpanel.h"
+#include "panels.h"
+#include "panelservice.h"
 #include "resources.h"
+#include "taskmodel.h"
 
 #include <LayerShellQt/shell.h>
 #include <QApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
 #include <QDebug>
 #include <glib.h>
+#include <optional>
 #include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
 #include <thread>
 
 static sigset_t signal_set;
@@ -50,8 +58,66 @@ static void signal_thread()
 // also used in resources.cpp
 void restore_signals(void *) { sigprocmask(SIG_UNBLOCK, &signal_set, nullptr); }
 
+struct Command
+{
+    const char * option;
+    const char * method;
+    const char * help;
+};
+
+static const Command commands[] = {
+    {"--toggle-menu", "ToggleMenu", "show or hide the applications menu"},
+    {"--focus-search", "FocusSearch", "open the menu and focus the search box"},
+    {"--reload", "Reload", "reload settings and applications"},
+    {"--stats", "Stats", "print performance counters"}};
+
+static const Command * findCommand(const char * option)
+{
+    for (auto & command : commands)
+    {
+        if (!strcmp(option, command.option))
+            return &command;
+    }
+
+    return nullptr;
+}
+
+static void printUsage(const char * name)
+{
+    fprintf(stderr, "Usage: %s [OPTION]\n\n", name);
+    fprintf(stderr, "Without options, start the panel. Options:\n");
+    for (auto & command : commands)
+        fprintf(stderr, "  %-16s %s\n", command.option, command.help);
+}
+
+// In idle power mode, timer slack lets the kernel merge the panel's
+// timer wakeups with other wakeups. The slack is per thread (inherited
+// by new threads), so this is done before Qt starts any.
+static void setPowerMode()
+{
+    if (Resources::loadSettings().idlePower)
+        prctl(PR_SET_TIMERSLACK, 50000000);
+}
+
 int main(int argc, char * argv[])
 {
+    // send a command to the running instance; any other arguments (such
+    // as -platform) are left to QApplication
+    if (argc > 1)
+    {
+        if (auto command = findCommand(argv[1]))
+        {
+            QCoreApplication app(argc, argv);
+            return PanelService::sendCommand(command->method);
+        }
+
+        if (!strcmp(argv[1], "--help"))
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+    }
+
     /* block signals first */
     sigemptyset(&signal_set);
     sigaddset(&signal_set, SIGHUP);
@@ -59,6 +125,8 @@ int main(int argc, char * argv[])
     sigaddset(&signal_set, SIGTERM);
     sigprocmask(SIG_BLOCK, &signal_set, nullptr);
 
+    setPowerMode();
+
     QApplication app(argc, argv);
     app.setAttribute(Qt::AA_UseHighDpiPixmaps, true);
 
@@ -68,15 +136,40 @@ int main(int argc, char * argv[])
     /* monitor signals once qApp exists */
     std::thread(signal_thread).detach();
 
-    Resources res;
-    MainPanel panel(res);
+    std::optional<Resources> res;
+    std::optional<TaskModel> tasks;
+    std::optional<Panels> panels;
+
+    PanelService service([&]() {
+        // destroy in reverse order since each refers to the previous
+        service.setPanels(nullptr);
+        panels.reset();
+        tasks.reset();
+        res.emplace();
+        tasks.emplace(*res);
+        panels.emplace(*res, *tasks);
+        service.setPanels(&*panels);
+    });
+
+    if (!service.isRegistered() &&
+        QDBusConnection::sessionBus().interface()->isServiceRegistered(
+            PanelService::serviceName))
+    {
+        qWarning() << "qmpanel is already running";
+        return 1;
+    }
+
+    res.emplace();
+    tasks.emplace(*res);
+    panels.emplace(*res, *tasks);
+    service.setPanels(&*panels);
 
     // Launch commands once D-Bus services are registered
     // Unset QT_WAYLAND_SHELL_INTEGRATION or else all launched
     // Qt applications will use layer-shell, wanted or not
     char ** env =
         g_environ_unsetenv(g_get_environ(), "QT_WAYLAND_SHELL_INTEGRATION");
-    for (auto & cmd : res.settings().launchCmds)
+    for (auto & cmd : res->settings().launchCmds)
     {
         char ** args = g_strsplit(cmd.toUtf8(), " ", -1);
         if (!g_spawn_async(nullptr, args, env, G_SPAWN_SEARCH_PATH,
@@ -50,6 +50,8 @@ class MainMenu : public QMenu
 public:
     MainMenu(Resources & res, QWidget * parent);
 
+    void focusSearch();
+
 protected:
     void keyPressEvent(QKeyEvent * e) override;
     void resizeEvent(QResizeEvent * e) override;
@@ -120,6 +122,12 @@ void MainMenu::showEvent(QShowEvent *)
     mSearchEdit.setFocus(Qt::OtherFocusReason);
 }
 
+void MainMenu::focusSearch()
+{
+    mSearchEdit.setFocus(Qt::OtherFocusReason);
+    mSearchEdit.selectAll();
+}
+
 void MainMenu::populate(Resources & res)
 {
     if (mPopulated)
@@ -202,3 +210,14 @@ MainMenuButton::MainMenuButton(Resources & res, MainPanel * panel)
     setStyleSheet("QToolButton::menu-indicator { image: none; }");
     setToolButtonStyle(Qt::ToolButtonIconOnly);
 }
+
+void MainMenuButton::toggleMenu(bool focusSearch)
+{
+    auto mainMenu = static_cast<MainMenu *>(menu());
+    if (!mainMenu->isVisible())
+        showMenu(); // search box gets focus in MainMenu::showEvent()
+    else if (focusSearch)
+        mainMenu->focusSearch();
+    else
+        mainMenu->hide();
+}
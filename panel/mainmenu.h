@@ -38,6 +38,8 @@ class MainMenuButton : public QToolButton
 {
 public:
     explicit MainMenuButton(Resources & res, MainPanel * panel);
+
+    void toggleMenu(bool focusSearch);
 };
 
 #endif
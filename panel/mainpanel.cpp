@@ -30,75 +30,78 @@
 
 #include "clocklabel.h"
 #include "mainmenu.h"
+#include "panelwindow.h"
 #include "quicklaunch.h"
 #include "statusnotifier/statusnotifier.h"
 #include "taskbar.h"
+#include "taskbutton.h"
+#include "x11props.h"
+#include "x11screenevents.h"
 
 #include <KX11Extras>
-#include <LayerShellQt/window.h>
 #include <NETWM>
 #include <QApplication>
+#include <QBackingStore>
 #include <QScreen>
 #include <private/qtx11extras_p.h>
 #include <private/qwayland-xdg-shell.h>
+#include <qpa/qplatformbackingstore.h>
 #include <stdlib.h>
 
-MainPanel::MainPanel(Resources & res) : mLayout(this)
+// set by popupMenu() for positionMenu()
+static const char * const menuAnchorProperty = "qmpanel_anchor";
+
+MainPanel::MainPanel(Resources & res, TaskModel & tasks, QScreen * screen)
+    : mTasks(tasks), mFixedScreen(screen), mLayout(this)
 {
     setAttribute(Qt::WA_AcceptDrops);
-    setAttribute(Qt::WA_AlwaysShowToolTips);
-    setAttribute(Qt::WA_X11NetWmWindowTypeDock);
-
-    setWindowFlags(Qt::FramelessWindowHint | Qt::WindowDoesNotAcceptFocus |
-                   Qt::WindowStaysOnTopHint);
 
     mLayout.setContentsMargins(QMargins());
     mLayout.setSpacing(logicalDpiX() / 24);
 
-    mLayout.addWidget(new MainMenuButton(res, this));
+    mMenuButton = new MainMenuButton(res, this);
+    mLayout.addWidget(mMenuButton);
     mLayout.addWidget(new QuickLaunch(res, this));
-    mLayout.addWidget(new TaskBar(res, this));
+    mTaskBar = new TaskBar(res, tasks, this);
+    mLayout.addWidget(mTaskBar);
     mLayout.addWidget(new StatusNotifier(this));
     mLayout.addWidget(new ClockLabel(this));
 
     mLayout.setStretch(2, 1); // stretch taskbar
 
-    if (qApp->nativeInterface<QNativeInterface::QWaylandApplication>())
-    {
-        (void)winId(); // create native window
-        auto layerShell = LayerShellQt::Window::get(windowHandle());
-        layerShell->setMargins(QMargins());
-        layerShell->setLayer(LayerShellQt::Window::Layer::LayerTop);
-        layerShell->setAnchors(LayerShellQt::Window::Anchors(
-            LayerShellQt::Window::Anchor::AnchorBottom |
-            LayerShellQt::Window::Anchor::AnchorLeft |
-            LayerShellQt::Window::Anchor::AnchorRight));
-        layerShell->setKeyboardInteractivity(
-            LayerShellQt::Window::KeyboardInteractivity::
-                KeyboardInteractivityNone);
-    }
-
-    show();
+    // creates the window
+    updateGeometry();
 
     if (QX11Info::isPlatformX11())
     {
-        KX11Extras::setOnDesktop(effectiveWinId(), NET::OnAllDesktops);
-        KX11Extras::setType(effectiveWinId(), NET::Dock);
+        WId window = mWindow->effectiveWinId();
+        KX11Extras::setOnDesktop(window, NET::OnAllDesktops);
+        KX11Extras::setType(window, NET::Dock);
     }
 
-    mUpdateTimer.setInterval(500);
+    // A monitor change usually comes as a burst of events (and signals).
+    // They are merged into one update, once Qt has processed all of them.
+    mUpdateTimer.setInterval(0);
     mUpdateTimer.setSingleShot(true);
 
     connect(&mUpdateTimer, &QTimer::timeout, this, &MainPanel::updateGeometry);
     connect(qApp, &QApplication::primaryScreenChanged, this,
-            &MainPanel::updateGeometryTriple);
+            &MainPanel::queueUpdateGeometry);
+
+    // Sometimes QScreen::virtualGeometry doesn't update immediately under
+    // XWayland, so RandR events are also watched directly.
+    if (QX11Info::isPlatformX11())
+    {
+        mScreenEvents.reset(
+            X11ScreenEvents::create([this]() { queueUpdateGeometry(); }));
+    }
 
     // Under Wayland (or XWayland), we pick our own screen, so we also
     // need to watch for new screens added.
     if (getenv("WAYLAND_DISPLAY"))
     {
         connect(qApp, &QApplication::screenAdded, this,
-                &MainPanel::updateGeometryTriple);
+                &MainPanel::queueUpdateGeometry);
     }
 }
 
@@ -109,6 +112,9 @@ MainPanel::~MainPanel()
     // signal handlers don't run in a partially destructed state.
     for (auto menu : mMenusRegistered)
         menu->disconnect(this);
+
+    // the windows must not delete the panel
+    setParent(nullptr);
 }
 
 void MainPanel::registerMenu(QMenu * menu)
@@ -133,14 +139,77 @@ void MainPanel::registerMenu(QMenu * menu)
     });
 }
 
-void MainPanel::updateGeometry2(bool inShowEvent)
+void MainPanel::toggleMenu(bool focusSearch)
+{
+    mMenuButton->toggleMenu(focusSearch);
+}
+
+QString MainPanel::stats() const
+{
+    auto & taskBar = mTasks.stats();
+    auto stats = QString("taskbar.events %1\n"
+                         "taskbar.merged %2\n"
+                         "taskbar.flushes %3\n"
+                         "taskbar.title_layouts %4\n"
+                         "x11.round_trips %5\n")
+                     .arg(taskBar.events)
+                     .arg(taskBar.merged)
+                     .arg(taskBar.flushes)
+                     .arg(ElidedText::layoutCount())
+                     .arg(getX11RoundTrips());
+
+#ifdef QMPANEL_BENCH
+    auto & paint = TaskButton::paintStats;
+    stats += QString("taskbar.paints %1\n"
+                     "taskbar.paint_usecs %2\n")
+                 .arg(paint.paints)
+                 .arg(paint.nsecs / 1000);
+
+    // latency from window event to repaint, by kind of change
+    static const char * const changes[TaskButton::CHANGE_COUNT] = {
+        "added", "changed", "activated"};
+
+    for (int i = 0; i < TaskButton::CHANGE_COUNT; i++)
+    {
+        auto count = paint.latencies[i];
+        stats += QString("taskbar.%1_latency_avg_usecs %2\n"
+                         "taskbar.%1_latency_max_usecs %3\n")
+                     .arg(changes[i])
+                     .arg(count ? paint.latencyNsecs[i] / count / 1000 : 0)
+                     .arg(paint.maxLatencyNsecs[i] / 1000);
+    }
+#endif
+
+    return stats;
+}
+
+static bool isWayland()
+{
+    return qApp->nativeInterface<QNativeInterface::QWaylandApplication>() !=
+           nullptr;
+}
+
+// The backing store still holds the last frame painted, unless the
+// platform cannot read it back (then the contents are rendered again).
+static QImage lastFrame(QWidget * window)
 {
-    QScreen * screen = QApplication::primaryScreen();
+    auto store = window->backingStore();
+    QImage image;
+    if (store && store->handle())
+        image = store->handle()->toImage();
+
+    return image.isNull() ? window->grab().toImage() : image;
+}
+
+void MainPanel::updateGeometry()
+{
+    QScreen * screen =
+        mFixedScreen ? mFixedScreen.data() : QApplication::primaryScreen();
     QRect rect = screen->geometry();
 
     // Under Wayland (or XWayland), the primary screen may not be set.
     // As a workaround, pick the largest/leftmost screen.
-    if (getenv("WAYLAND_DISPLAY"))
+    if (!mFixedScreen && getenv("WAYLAND_DISPLAY"))
     {
         for (QScreen * testScreen : screen->virtualSiblings())
         {
@@ -160,84 +229,88 @@ void MainPanel::updateGeometry2(bool inShowEvent)
         if (mScreen)
         {
             disconnect(mScreen, &QScreen::geometryChanged, this,
-                       &MainPanel::updateGeometryTriple);
+                       &MainPanel::queueUpdateGeometry);
             disconnect(mScreen, &QScreen::virtualGeometryChanged, this,
-                       &MainPanel::updateGeometryTriple);
+                       &MainPanel::queueUpdateGeometry);
             disconnect(mScreen, &QObject::destroyed, this,
-                       &MainPanel::updateGeometryTriple);
+                       &MainPanel::queueUpdateGeometry);
         }
 
         mScreen = screen;
+        mTaskBar->setScreen(screen);
         connect(mScreen, &QScreen::geometryChanged, this,
-                &MainPanel::updateGeometryTriple);
+                &MainPanel::queueUpdateGeometry);
         connect(mScreen, &QScreen::virtualGeometryChanged, this,
-                &MainPanel::updateGeometryTriple);
+                &MainPanel::queueUpdateGeometry);
         connect(mScreen, &QObject::destroyed, this,
-                &MainPanel::updateGeometryTriple);
+                &MainPanel::queueUpdateGeometry);
 
-        // layer-shell surfaces are tied to a specific screen once
-        // shown. To change screens, we have to hide and reshow.
-        // updateGeometry() will be called again from the showEvent().
-        if (qApp->nativeInterface<QNativeInterface::QWaylandApplication>() &&
-            !inShowEvent)
+        // Layer-shell surfaces are tied to a specific screen once shown.
+        // To change screens, the contents are moved to a new window, once
+        // it is showing what they last looked like (see swapWindow()).
+        if (!mWindow)
+        {
+            mWindow.reset(new PanelWindow(screen));
+            mWindow->setContents(this);
+        }
+        else if (isWayland() && mWindow->screen() == screen)
+            mNextWindow.reset(); // moved back before the swap
+        else if (isWayland() &&
+                 (!mNextWindow || mNextWindow->screen() != screen))
         {
-            hide(), show();
-            return;
+            mNextWindow.reset(new PanelWindow(screen));
+            mNextWindow->setPlaceholder(lastFrame(mWindow.get()),
+                                        [this]() { swapWindow(); });
         }
     }
 
+    auto window = mNextWindow ? mNextWindow.get() : mWindow.get();
+
     rect.setTop(rect.bottom() + 1 - sizeHint().height());
-    if (rect != geometry())
+    if (rect != window->geometry())
     {
-        setFixedSize(rect.size());
-        setGeometry(rect);
+        window->setFixedSize(rect.size());
+        window->setGeometry(rect);
     }
 
-    if (QX11Info::isPlatformX11())
+    // virtualGeometry() usually matches the X11 screen (not monitor) size
+    QRect strut(rect.topLeft(),
+                QPoint(rect.right(), screen->virtualGeometry().bottom()));
+
+    if (QX11Info::isPlatformX11() && strut != mStrut)
     {
-        // virtualGeometry() usually matches the X11 screen (not monitor) size
-        int screenBottom = screen->virtualGeometry().bottom();
-        KX11Extras::setExtendedStrut(effectiveWinId(),
+        KX11Extras::setExtendedStrut(window->effectiveWinId(),
                                      /* left   */ 0, 0, 0,
                                      /* right  */ 0, 0, 0,
                                      /* top    */ 0, 0, 0,
-                                     /* bottom */ screenBottom + 1 - rect.top(),
-                                     rect.left(), rect.right());
+                                     /* bottom */ strut.height(),
+                                     strut.left(), strut.right());
         xcb_flush(QX11Info::connection());
+        mStrut = strut;
     }
 
-    if (qApp->nativeInterface<QNativeInterface::QWaylandApplication>())
-    {
-        auto layerShell = LayerShellQt::Window::get(windowHandle());
-        layerShell->setExclusiveZone(height());
-    }
-
-    if (mUpdateCount > 0)
-    {
-        mUpdateTimer.start();
-        mUpdateCount--;
-    }
+    window->setExclusiveZone(rect.height());
+    window->show();
 }
 
-void MainPanel::updateGeometryTriple()
+// Called once the new window has shown its first frame
+void MainPanel::swapWindow()
 {
-    // Sometimes QScreen::virtualGeometry doesn't update immediately
-    // under XWayland (due to missing RandR events). As a workaround,
-    // check for changes again after 0.5s and after 1s.
-    mUpdateCount = 2;
-    updateGeometry();
+    // popups of the old surface would be destroyed along with it
+    for (auto menu : QSet<QMenu *>(mMenusShown))
+        menu->close();
+    mMenusShown.clear();
+
+    mNextWindow->setContents(this);
+    mWindow = std::move(mNextWindow); // deletes the old window
+    updateKeyboardInteractivity();
 }
 
 void MainPanel::updateKeyboardInteractivity()
 {
-    if (qApp->nativeInterface<QNativeInterface::QWaylandApplication>())
+    if (isWayland())
     {
-        auto layerShell = LayerShellQt::Window::get(windowHandle());
-        layerShell->setKeyboardInteractivity(
-            mMenusShown.empty() ? LayerShellQt::Window::KeyboardInteractivity::
-                                      KeyboardInteractivityNone
-                                : LayerShellQt::Window::KeyboardInteractivity::
-                                      KeyboardInteractivityExclusive);
+        mWindow->setKeyboardInteractivity(!mMenusShown.empty());
         // Force a surface commit immediately, before the menu popup is
         // created and attempts to grab the keyboard. update() results
         // in a delayed commit and does not work here.
@@ -245,15 +318,34 @@ void MainPanel::updateKeyboardInteractivity()
     }
 }
 
+void MainPanel::popupMenu(QMenu * menu, const QRect & anchor)
+{
+    auto parent = menu->parentWidget();
+    menu->setProperty(menuAnchorProperty, anchor);
+
+    // open upward from the panel, as under Wayland (see positionMenu),
+    // unless there is no room above
+    QRect rect(parent->mapToGlobal(anchor.topLeft()), anchor.size());
+    QPoint pos(rect.left(), rect.top() - menu->sizeHint().height());
+    if (pos.y() < parent->screen()->geometry().top())
+        pos.ry() = rect.bottom() + 1;
+
+    menu->popup(pos);
+}
+
 void MainPanel::positionMenu(QMenu * menu)
 {
     if (qApp->nativeInterface<QNativeInterface::QWaylandApplication>())
     {
         (void)menu->winId(); // create native window
         auto parent = menu->parentWidget();
+        auto anchor = menu->property(menuAnchorProperty).toRect();
+        if (!anchor.isValid())
+            anchor = parent->rect();
+
         menu->windowHandle()->setProperty(
             "_q_waylandPopupAnchorRect",
-            QRect(parent->mapTo(this, QPoint()), parent->size()));
+            QRect(parent->mapTo(this, anchor.topLeft()), anchor.size()));
         menu->windowHandle()->setProperty(
             "_q_waylandPopupAnchor",
             QVariant::fromValue(Qt::Edge::TopEdge | Qt::Edge::LeftEdge));
@@ -34,36 +34,49 @@
 #include <QSet>
 #include <QTimer>
 #include <QWidget>
+#include <memory>
 
+class MainMenuButton;
+class PanelWindow;
 class QMenu;
 class Resources;
+class TaskBar;
+class TaskModel;
+class X11ScreenEvents;
 
 class MainPanel : public QWidget
 {
 public:
-    MainPanel(Resources & res);
+    // screen is null to pick the primary (or largest) screen
+    MainPanel(Resources & res, TaskModel & tasks, QScreen * screen = nullptr);
     ~MainPanel();
 
     void registerMenu(QMenu * menu);
-
-protected:
-    void showEvent(QShowEvent * event) override
-    {
-        updateGeometry2(true);
-        QWidget::showEvent(event);
-    }
+    // opens a registered menu next to the given rectangle (in the
+    // coordinates of the menu's parent), rather than the whole parent
+    void popupMenu(QMenu * menu, const QRect & anchor);
+    void toggleMenu(bool focusSearch);
+    QString stats() const;
+    QScreen * panelScreen() const { return mScreen; }
 
 private:
+    MainMenuButton * mMenuButton;
+    TaskModel & mTasks;
+    TaskBar * mTaskBar;
+    QPointer<QScreen> const mFixedScreen;
     QPointer<QScreen> mScreen;
     QHBoxLayout mLayout;
     QSet<QMenu *> mMenusRegistered;
     QSet<QMenu *> mMenusShown;
     QTimer mUpdateTimer;
-    int mUpdateCount = 0;
+    std::unique_ptr<X11ScreenEvents> mScreenEvents;
+    QRect mStrut; // last set (X11), in root window coordinates
+    std::unique_ptr<PanelWindow> mWindow;     // holding the contents
+    std::unique_ptr<PanelWindow> mNextWindow; // on a new screen (Wayland)
 
-    void updateGeometry2(bool inShowEvent);
-    void updateGeometry() { updateGeometry2(false); }
-    void updateGeometryTriple();
+    void updateGeometry();
+    void queueUpdateGeometry() { mUpdateTimer.start(); }
+    void swapWindow();
     void updateKeyboardInteractivity();
     void positionMenu(QMenu * menu);
 };
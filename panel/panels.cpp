@@ -0,0 +1,107 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "panels.h"
+#include "mainpanel.h"
+#include "resources.h"
+
+#include <QAbstractEventDispatcher>
+#include <QGuiApplication>
+#include <QScreen>
+
+// times the event loop woke up (from a timer, socket, etc.) for --stats
+static quint64 wakeups;
+
+Panels::Panels(Resources & res, TaskModel & tasks) : mRes(res), mTasks(tasks)
+{
+    mConnections[2] =
+        QObject::connect(QAbstractEventDispatcher::instance(),
+                         &QAbstractEventDispatcher::awake, []() { wakeups++; });
+
+    if (!res.settings().panelAllScreens)
+    {
+        addPanel(nullptr); // screen chosen by MainPanel
+        return;
+    }
+
+    for (auto screen : QGuiApplication::screens())
+        addPanel(screen);
+
+    mConnections[0] =
+        QObject::connect(qGuiApp, &QGuiApplication::screenAdded,
+                         [this](QScreen * screen) { addPanel(screen); });
+    mConnections[1] =
+        QObject::connect(qGuiApp, &QGuiApplication::screenRemoved,
+                         [this](QScreen * screen) { removePanel(screen); });
+}
+
+Panels::~Panels()
+{
+    for (auto & connection : mConnections)
+        QObject::disconnect(connection);
+}
+
+void Panels::toggleMenu(bool focusSearch)
+{
+    if (auto panel = primary())
+        panel->toggleMenu(focusSearch);
+}
+
+// the counters are shared by all panels
+QString Panels::stats() const
+{
+    auto panel = primary();
+    return (panel ? panel->stats() : QString()) +
+           QString("panel.wakeups %1\n").arg(wakeups);
+}
+
+void Panels::addPanel(QScreen * screen)
+{
+    mPanels.emplace_back(new MainPanel(mRes, mTasks, screen));
+}
+
+void Panels::removePanel(QScreen * screen)
+{
+    for (auto it = mPanels.begin(); it != mPanels.end(); ++it)
+    {
+        if ((*it)->panelScreen() == screen)
+        {
+            mPanels.erase(it);
+            break;
+        }
+    }
+}
+
+MainPanel * Panels::primary() const
+{
+    for (auto & panel : mPanels)
+    {
+        if (panel->panelScreen() == QGuiApplication::primaryScreen())
+            return panel.get();
+    }
+
+    return mPanels.empty() ? nullptr : mPanels[0].get();
+}
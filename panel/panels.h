@@ -0,0 +1,64 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef PANELS_H
+#define PANELS_H
+
+#include <QMetaObject>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class MainPanel;
+class QScreen;
+class Resources;
+class TaskModel;
+
+// The panel on the primary (or largest) screen, or with PanelScreens=all,
+// one panel on each screen. All panels share the Resources and the task
+// model, so each extra panel costs only its widgets.
+class Panels
+{
+public:
+    Panels(Resources & res, TaskModel & tasks);
+    ~Panels();
+
+    // commands go to the panel on the primary screen
+    void toggleMenu(bool focusSearch);
+    QString stats() const;
+
+private:
+    void addPanel(QScreen * screen);
+    void removePanel(QScreen * screen);
+    MainPanel * primary() const;
+
+    Resources & mRes;
+    TaskModel & mTasks;
+    std::vector<std::unique_ptr<MainPanel>> mPanels;
+    QMetaObject::Connection mConnections[3];
+};
+
+#endif // PANELS_H
@@ -0,0 +1,125 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "panelservice.h"
+#include "panels.h"
+
+#include <QApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDebug>
+#include <QThread>
+#include <QTimer>
+#include <stdio.h>
+
+PanelService::PanelService(std::function<void()> reload)
+    : mReload(std::move(reload))
+{
+    auto dbus = QDBusConnection::sessionBus();
+    auto reply = dbus.interface()->registerService(
+        serviceName, QDBusConnectionInterface::DontQueueService);
+
+    if (reply.value() != QDBusConnectionInterface::ServiceRegistered)
+    {
+        qWarning() << "PanelService: unable to register service for"
+                   << serviceName;
+        return;
+    }
+
+    if (!dbus.registerObject(objectPath, this,
+                             QDBusConnection::ExportScriptableContents))
+        qWarning() << dbus.lastError().message();
+
+    mRegistered = true;
+}
+
+PanelService::~PanelService()
+{
+    if (mRegistered)
+        QDBusConnection::sessionBus().unregisterService(serviceName);
+}
+
+int PanelService::sendCommand(const char * method)
+{
+    auto msg = QDBusMessage::createMethodCall(serviceName, objectPath,
+                                              serviceName, method);
+    auto reply = QDBusConnection::sessionBus().call(msg);
+    if (reply.type() == QDBusMessage::ErrorMessage)
+    {
+        qWarning() << "qmpanel is not running:" << reply.errorMessage();
+        return 1;
+    }
+
+    // print text replies (i.e. Stats)
+    for (auto & arg : reply.arguments())
+        fputs(arg.toString().toUtf8(), stdout);
+
+    return 0;
+}
+
+// The actions below are queued so that the D-Bus reply goes out first.
+// Showing a menu runs a nested event loop and would block the client.
+
+void PanelService::ToggleMenu()
+{
+    QTimer::singleShot(0, this, [this]() {
+        if (mPanels)
+            mPanels->toggleMenu(false);
+    });
+}
+
+void PanelService::FocusSearch()
+{
+    QTimer::singleShot(0, this, [this]() {
+        if (mPanels)
+            mPanels->toggleMenu(true);
+    });
+}
+
+void PanelService::Reload() { reloadAfter(0); }
+
+void PanelService::reloadAfter(int msecs)
+{
+    QTimer::singleShot(msecs, this, [this]() {
+        // The panel cannot be destroyed from a nested event loop (such
+        // as an open menu or dialog), so close any popup and try again
+        // a little later rather than spinning until the loop exits.
+        if (QThread::currentThread()->loopLevel() > 1)
+        {
+            if (auto popup = QApplication::activePopupWidget())
+                popup->close();
+            reloadAfter(100);
+        }
+        else
+            mReload();
+    });
+}
+
+QString PanelService::Stats()
+{
+    return mPanels ? mPanels->stats() : QString();
+}
@@ -0,0 +1,69 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef PANELSERVICE_H
+#define PANELSERVICE_H
+
+#include <QObject>
+#include <functional>
+
+class Panels;
+
+// D-Bus interface used by "qmpanel --<command>" to control the running
+// instance. Owning the service name also makes qmpanel single-instance.
+class PanelService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.qmpanel.Panel")
+
+public:
+    static constexpr const char * serviceName = "org.qmpanel.Panel";
+    static constexpr const char * objectPath = "/Panel";
+
+    explicit PanelService(std::function<void()> reload);
+    ~PanelService();
+
+    bool isRegistered() const { return mRegistered; }
+    void setPanels(Panels * panels) { mPanels = panels; }
+
+    // client side: returns an exit status for main()
+    static int sendCommand(const char * method);
+
+public slots:
+    Q_SCRIPTABLE void ToggleMenu();
+    Q_SCRIPTABLE void FocusSearch();
+    Q_SCRIPTABLE void Reload();
+    Q_SCRIPTABLE QString Stats();
+
+private:
+    void reloadAfter(int msecs);
+
+    std::function<void()> mReload;
+    Panels * mPanels = nullptr;
+    bool mRegistered = false;
+};
+
+#endif // PANELSERVICE_H
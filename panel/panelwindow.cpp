@@ -0,0 +1,114 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "panelwindow.h"
+
+#include <LayerShellQt/window.h>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QWindow>
+
+PanelWindow::PanelWindow(QScreen * screen) : mLayout(this)
+{
+    setAttribute(Qt::WA_AlwaysShowToolTips);
+    setAttribute(Qt::WA_X11NetWmWindowTypeDock);
+
+    setWindowFlags(Qt::FramelessWindowHint | Qt::WindowDoesNotAcceptFocus |
+                   Qt::WindowStaysOnTopHint);
+
+    mLayout.setContentsMargins(QMargins());
+
+    (void)winId(); // create native window
+    windowHandle()->setScreen(screen);
+
+    if (qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>())
+    {
+        auto layerShell = LayerShellQt::Window::get(windowHandle());
+        layerShell->setMargins(QMargins());
+        layerShell->setLayer(LayerShellQt::Window::Layer::LayerTop);
+        layerShell->setAnchors(LayerShellQt::Window::Anchors(
+            LayerShellQt::Window::Anchor::AnchorBottom |
+            LayerShellQt::Window::Anchor::AnchorLeft |
+            LayerShellQt::Window::Anchor::AnchorRight));
+        setKeyboardInteractivity(false);
+    }
+}
+
+void PanelWindow::setContents(QWidget * contents)
+{
+    mPlaceholder = QImage();
+    mPlaceholderPainted = nullptr;
+
+    mLayout.addWidget(contents);
+    contents->show();
+}
+
+void PanelWindow::setPlaceholder(QImage image, std::function<void()> painted)
+{
+    mPlaceholder = std::move(image);
+    mPlaceholderPainted = std::move(painted);
+    update();
+}
+
+void PanelWindow::setExclusiveZone(int zone)
+{
+    if (zone != mExclusiveZone &&
+        qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>())
+    {
+        LayerShellQt::Window::get(windowHandle())->setExclusiveZone(zone);
+        mExclusiveZone = zone;
+    }
+}
+
+void PanelWindow::setKeyboardInteractivity(bool exclusive)
+{
+    if (qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>())
+    {
+        LayerShellQt::Window::get(windowHandle())
+            ->setKeyboardInteractivity(
+                exclusive ? LayerShellQt::Window::KeyboardInteractivity::
+                                KeyboardInteractivityExclusive
+                          : LayerShellQt::Window::KeyboardInteractivity::
+                                KeyboardInteractivityNone);
+    }
+}
+
+void PanelWindow::paintEvent(QPaintEvent *)
+{
+    if (mPlaceholder.isNull())
+        return;
+
+    QPainter(this).drawImage(rect(), mPlaceholder);
+
+    // the frame is committed once painting returns, so the contents can
+    // be moved in from the next iteration of the event loop
+    if (mPlaceholderPainted)
+    {
+        QMetaObject::invokeMethod(this, std::move(mPlaceholderPainted),
+                                  Qt::QueuedConnection);
+        mPlaceholderPainted = nullptr;
+    }
+}
@@ -0,0 +1,62 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef PANELWINDOW_H
+#define PANELWINDOW_H
+
+#include <QHBoxLayout>
+#include <QImage>
+#include <QWidget>
+#include <functional>
+
+// Top-level window holding the panel's contents (MainPanel). Under
+// Wayland, a layer-shell surface is tied to one output once shown, so
+// the contents are moved to a new PanelWindow to change screens.
+class PanelWindow : public QWidget
+{
+public:
+    explicit PanelWindow(QScreen * screen);
+
+    void setContents(QWidget * contents);
+    // shown until setContents() is called, e.g. the contents as last
+    // painted in the previous window
+    void setPlaceholder(QImage image, std::function<void()> painted);
+
+    // these only update the layer surface if the value changed
+    void setExclusiveZone(int zone);
+    void setKeyboardInteractivity(bool exclusive);
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+
+private:
+    QHBoxLayout mLayout;
+    QImage mPlaceholder;
+    std::function<void()> mPlaceholderPainted;
+    int mExclusiveZone = -1;
+};
+
+#endif // PANELWINDOW_H
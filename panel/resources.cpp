@@ -186,14 +186,31 @@ Resources::Settings Resources::loadSettings()
     auto pinnedMenuApps = getSetting("PinnedMenuApps");
     auto quickLaunchApps = getSetting("QuickLaunchApps");
     auto launchCmds = getSetting("LaunchCmds");
+    auto taskBarMode = getSetting("TaskBarMode");
+    auto taskBarScreen = getSetting("TaskBarScreen");
+    auto panelScreens = getSetting("PanelScreens");
+    auto powerMode = getSetting("PowerMode");
 
     return {menuIcon.isEmpty() ? "start-here" : menuIcon,
             pinnedMenuApps.split(';', Qt::SkipEmptyParts),
             quickLaunchApps.split(';', Qt::SkipEmptyParts),
-            launchCmds.split(';', Qt::SkipEmptyParts)};
+            launchCmds.split(';', Qt::SkipEmptyParts),
+            taskBarMode == "strip",
+            taskBarScreen == "panel",
+            panelScreens == "all",
+            powerMode == "idle"};
 }
 
 QIcon Resources::getAppIcon(const QString & appName)
+{
+    auto iter = mAppIconCache.find(appName);
+    if (iter == mAppIconCache.end())
+        iter = mAppIconCache.emplace(appName, lookupAppIcon(appName)).first;
+
+    return iter->second;
+}
+
+QIcon Resources::lookupAppIcon(const QString & appName)
 {
     // try exact match of appName + ".desktop" first
     auto iter = mAppInfos.find(appName + ".desktop");
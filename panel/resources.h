@@ -63,9 +63,15 @@ public:
         QStringList pinnedMenuApps;
         QStringList quickLaunchApps;
         QStringList launchCmds;
+        bool taskBarStrip;
+        bool taskBarPanelScreen; // Wayland only
+        bool panelAllScreens;
+        bool idlePower; // fewest possible wakeups while idle
     };
 
     static QIcon getIcon(const QString & name);
+    // needs no QApplication
+    static Settings loadSettings();
 
     const Settings & settings() const { return mSettings; }
 
@@ -80,11 +86,14 @@ private:
 
     static AppInfoMap loadAppInfos();
     static AppNameMap makeAppNameMap(AppInfoMap & appInfos);
-    static Settings loadSettings();
+
+    QIcon lookupAppIcon(const QString & appName);
 
     AppInfoMap mAppInfos = loadAppInfos();
     AppNameMap mAppNameMap = makeAppNameMap(mAppInfos);
     Settings mSettings = loadSettings();
+    // including null icons for unknown apps
+    std::unordered_map<QString, QIcon> mAppIconCache;
 };
 
 #endif
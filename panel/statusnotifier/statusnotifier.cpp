@@ -34,11 +34,18 @@
 #include <QBoxLayout>
 #include <unistd.h>
 
-StatusNotifier::StatusNotifier(MainPanel * panel)
-    : QWidget(panel), mPanel(panel), mLayout(this)
+// The watcher and host are registered once (on D-Bus) for all panels,
+// and released along with the last panel.
+static std::shared_ptr<StatusNotifierWatcher> getWatcher()
 {
-    mLayout.setContentsMargins(QMargins());
-    mLayout.setSpacing(logicalDpiX() / 24);
+    static std::weak_ptr<StatusNotifierWatcher> shared;
+
+    auto watcher = shared.lock();
+    if (watcher)
+        return watcher;
+
+    watcher = std::make_shared<StatusNotifierWatcher>();
+    shared = watcher;
 
     QString dbusName =
         QStringLiteral("org.kde.StatusNotifierHost-%1-1").arg(getpid());
@@ -51,14 +58,23 @@ StatusNotifier::StatusNotifier(MainPanel * panel)
                    << dbusName;
     }
 
-    mWatcher.RegisterStatusNotifierHost(dbusName);
+    watcher->RegisterStatusNotifierHost(dbusName);
+    return watcher;
+}
+
+StatusNotifier::StatusNotifier(MainPanel * panel)
+    : QWidget(panel), mPanel(panel), mWatcher(getWatcher()), mLayout(this)
+{
+    mLayout.setContentsMargins(QMargins());
+    mLayout.setSpacing(logicalDpiX() / 24);
 
-    connect(&mWatcher, &StatusNotifierWatcher::StatusNotifierItemRegistered,
+    auto watcher = mWatcher.get();
+    connect(watcher, &StatusNotifierWatcher::StatusNotifierItemRegistered,
             this, &StatusNotifier::itemAdded);
-    connect(&mWatcher, &StatusNotifierWatcher::StatusNotifierItemUnregistered,
+    connect(watcher, &StatusNotifierWatcher::StatusNotifierItemUnregistered,
             this, &StatusNotifier::itemRemoved);
 
-    for (const auto & service : mWatcher.RegisteredStatusNotifierItems())
+    for (const auto & service : watcher->RegisteredStatusNotifierItems())
         itemAdded(service);
 }
 
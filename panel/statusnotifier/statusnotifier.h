@@ -34,6 +34,7 @@
 
 #include <QBoxLayout>
 #include <QWidget>
+#include <memory>
 
 class MainPanel;
 class StatusNotifierIcon;
@@ -49,7 +50,7 @@ private:
     void itemRemoved(const QString & serviceAndPath);
 
     MainPanel * const mPanel;
-    StatusNotifierWatcher mWatcher;
+    std::shared_ptr<StatusNotifierWatcher> mWatcher; // shared by all panels
     QHash<QString, StatusNotifierIcon *> mServices;
     QHBoxLayout mLayout;
 };
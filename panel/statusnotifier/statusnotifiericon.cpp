@@ -35,6 +35,7 @@
 
 #include <QMenu>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QStyle>
 #include <QtEndian>
 
@@ -69,8 +70,15 @@ StatusNotifierIcon::StatusNotifierIcon(QString service, QString objectPath,
     newToolTip();
 
     // set initial icon
-    auto icon = style()->standardIcon(QStyle::SP_FileIcon);
-    setPixmap(icon.pixmap(style()->pixelMetric(QStyle::PM_ButtonIconSize)));
+    int size = style()->pixelMetric(QStyle::PM_ButtonIconSize);
+    setFixedSize(size, size);
+    setIcon(style()->standardIcon(QStyle::SP_FileIcon));
+}
+
+void StatusNotifierIcon::setIcon(const QIcon & icon)
+{
+    mIcon = icon;
+    update();
 }
 
 void StatusNotifierIcon::getPropertyAsync(
@@ -140,10 +148,7 @@ void StatusNotifierIcon::newIcon()
         {
             auto icon = Resources::getIcon(iconName);
             if (!icon.isNull())
-            {
-                setPixmap(icon.pixmap(
-                    style()->pixelMetric(QStyle::PM_ButtonIconSize)));
-            }
+                setIcon(icon);
         }
         else
         {
@@ -151,10 +156,7 @@ void StatusNotifierIcon::newIcon()
                 auto pixmaps = qdbus_cast<IconPixmapList>(value);
                 auto icon = iconFromPixmapList(pixmaps);
                 if (!icon.isNull())
-                {
-                    setPixmap(icon.pixmap(
-                        style()->pixelMetric(QStyle::PM_ButtonIconSize)));
-                }
+                    setIcon(icon);
             });
         }
     });
@@ -187,3 +189,11 @@ void StatusNotifierIcon::mousePressEvent(QMouseEvent * event)
     else if (Qt::RightButton == event->button())
         mSni.ContextMenu(pos.x(), pos.y());
 }
+
+// QIcon picks (and caches) a pixmap for the painter's device pixel ratio,
+// which follows the output's (possibly fractional) scale
+void StatusNotifierIcon::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    mIcon.paint(&painter, contentsRect());
+}
@@ -32,6 +32,7 @@
 
 #include "statusnotifieriteminterface.h"
 
+#include <QIcon>
 #include <QLabel>
 #include <QPointer>
 #include <functional>
@@ -49,17 +50,20 @@ public:
                           std::function<void(const QVariant &)> finished);
 
 private:
+    void setIcon(const QIcon & icon);
     void addActivate();
     void newIcon();
     void newToolTip();
 
     org::kde::StatusNotifierItem mSni;
     QString mTitle;
+    QIcon mIcon;
     QPointer<QMenu> mMenu;
     QPointer<QAction> mActivate;
 
 protected:
     void mousePressEvent(QMouseEvent * event);
+    void paintEvent(QPaintEvent *) override;
 };
 
 #endif // STATUSNOTIFIERICON_H
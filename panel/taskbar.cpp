@@ -30,194 +30,208 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "taskbar.h"
+#include "resources.h"
 #include "taskbutton.h"
-#include "wlr-foreign-toplevel-management-unstable-v1.h"
+#include "taskstrip.h"
 
-#include <KWindowInfo>
-#include <KX11Extras>
 #include <QGuiApplication>
-#include <private/qtx11extras_p.h>
+#include <qpa/qplatformnativeinterface.h>
 
-TaskBar::TaskBar(Resources & res, QWidget * parent)
-    : QWidget(parent), mRes(res), mLayout(this)
+TaskBar::TaskBar(Resources & res, TaskModel & model, MainPanel * panel)
+    : QWidget(panel), mModel(model), mLayout(this)
 {
     mLayout.setContentsMargins(QMargins());
     mLayout.setSpacing(0);
-    mLayout.addStretch(1);
 
-    setAcceptDrops(true);
-
-    if (QX11Info::isPlatformX11())
+    if (res.settings().taskBarStrip)
     {
-        for (auto window : KX11Extras::stackingOrder())
-        {
-            if (acceptWindow(window))
-                addWindow(window);
-        }
-
-        connect(KX11Extras::self(), &KX11Extras::windowAdded, this,
-                &TaskBar::onWindowAdded);
-        connect(KX11Extras::self(), &KX11Extras::windowRemoved, this,
-                &TaskBar::removeWindow);
-        connect(KX11Extras::self(), &KX11Extras::activeWindowChanged, this,
-                &TaskBar::onActiveWindowChanged);
-        connect(KX11Extras::self(), &KX11Extras::windowChanged, this,
-                &TaskBar::onWindowChanged);
+        mStrip = new TaskStrip(model, panel, this);
+        mLayout.addWidget(mStrip);
     }
+    else
+        mLayout.addStretch(1);
+
+    setAcceptDrops(true);
 
-    auto waylandApp =
+    // the strip has no buttons to hover
+    if (!mStrip)
+        mThumbnails = model.thumbnails();
+
+    // only Wayland reports the outputs of each window
+    mFilterOutputs =
+        res.settings().taskBarPanelScreen &&
         qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>();
-    if (waylandApp)
+
+    for (auto id : model.ids())
+        addTask(id);
+
+    mListener = model.addListener({
+        [this](TaskModel::Id id) {
+            addTask(id);
+            if (onScreen(id))
+                markChanged(id, TaskButton::Added);
+        },
+        [this](TaskModel::Id id) { removeTask(id); },
+        [this](TaskModel::Id id, int fields) { updateTask(id, fields); },
+    });
+}
+
+TaskBar::~TaskBar()
+{
+    mModel.removeListener(mListener);
+
+    // delete buttons while the thumbnails still exist
+    for (auto & pair : mButtons)
+        delete pair.second;
+}
+
+void TaskBar::setScreen(QScreen * screen)
+{
+    if (!mFilterOutputs)
+        return;
+
+    auto native = QGuiApplication::platformNativeInterface();
+    auto output = screen ? native->nativeResourceForScreen("output", screen)
+                         : nullptr;
+    quint32 mask = output ? mModel.outputMask(output) : 0;
+
+    if (mask != mOutputMask)
     {
-        static const wl_registry_listener registry_listener_impl = {
-            .global =
-                [](void * data, wl_registry * registry, uint32_t name,
-                   const char * interface, uint32_t version) {
-                    auto self = static_cast<TaskBar *>(data);
-                    if (!strcmp(
-                            interface,
-                            zwlr_foreign_toplevel_manager_v1_interface.name))
-                        self->addToplevelManager(registry, name, version);
-                },
-            .global_remove = [](void * data, wl_registry * registry,
-                                uint32_t name) { /* no-op */ }};
-
-        wl_registry_add_listener(wl_display_get_registry(waylandApp->display()),
-                                 &registry_listener_impl, this);
-        // TODO: cleanup listener at exit?
+        mOutputMask = mask;
+        for (auto id : mModel.ids())
+            updateVisibility(id);
     }
 }
 
-void TaskBar::addToplevelManager(wl_registry * registry, uint32_t name,
-                                 uint32_t version)
+void TaskBar::addTask(TaskModel::Id id)
 {
-    version = std::min<uint32_t>(
-        version, zwlr_foreign_toplevel_manager_v1_interface.version);
-    auto manager = static_cast<zwlr_foreign_toplevel_manager_v1 *>(
-        wl_registry_bind(registry, name,
-                         &zwlr_foreign_toplevel_manager_v1_interface, version));
-    if (!manager)
+    if (mStrip)
     {
-        qWarning()
-            << "Could not bind zwlr_foreign_toplevel_manager_v1_interface";
+        updateVisibility(id);
         return;
     }
 
-    static const zwlr_foreign_toplevel_manager_v1_listener
-        toplevel_manager_impl = {
-            .toplevel =
-                [](void * data, zwlr_foreign_toplevel_manager_v1 * manager,
-                   zwlr_foreign_toplevel_handle_v1 * handle) {
-                    static_cast<TaskBar *>(data)->addWindow(handle);
-                },
-            .finished =
-                [](void * data, zwlr_foreign_toplevel_manager_v1 * manager) {
-                    /* no-op */
-                },
-        };
-
-    zwlr_foreign_toplevel_manager_v1_add_listener(manager,
-                                                  &toplevel_manager_impl, this);
-    // TODO: cleanup listener at exit?
-}
+    auto button = new TaskButton(mModel, id, mThumbnails, this);
+    mButtons[id] = button;
+
+    button->setTitle(mModel.title(id));
+    button->setTaskIcon(mModel.icon(id));
+    button->setChecked(mModel.states(id) & TaskModel::Active);
+
+    connect(button, &QToolButton::clicked, this, [this, button](bool checked) {
+        if (checked)
+            mClickedButton = button;
+    });
 
-void TaskBar::addWindow(zwlr_foreign_toplevel_handle_v1 * handle)
-{
-    auto button = new TaskButtonWayland(mRes, handle, this);
     mLayout.insertWidget(mLayout.count() - 1, button);
+
+    // with TaskBarScreen=panel, the button is hidden until the window
+    // is known to be on the panel's screen
+    updateVisibility(id);
 }
 
-bool TaskBar::acceptWindow(WId window) const
+void TaskBar::removeTask(TaskModel::Id id)
 {
-    const NET::WindowTypes ignoreList =
-        NET::DesktopMask | NET::DockMask | NET::SplashMask | NET::ToolbarMask |
-        NET::MenuMask | NET::PopupMenuMask | NET::NotificationMask;
-
-    KWindowInfo info(window, NET::WMWindowType | NET::WMState,
-                     NET::WM2TransientFor);
-
-    if (!info.valid() ||
-        NET::typeMatchesMask(info.windowType(NET::AllTypesMask), ignoreList) ||
-        (info.state() & NET::SkipTaskbar))
+    if (mStrip)
     {
-        return false;
+        mStrip->removeTask(id);
+        return;
     }
 
-    WId transFor = info.transientFor();
-    if (transFor == 0 || transFor == window ||
-        transFor == (WId)QX11Info::appRootWindow())
-    {
-        return true;
-    }
+    auto pos = mButtons.find(id);
+    if (pos == mButtons.end())
+        return;
+
+    auto button = pos->second;
+    mButtons.erase(pos);
+
+    if (mClickedButton == button)
+        mClickedButton = nullptr;
 
-    return false;
+    delete button;
 }
 
-void TaskBar::addWindow(WId window)
+void TaskBar::updateTask(TaskModel::Id id, int fields)
 {
-    if (mKnownWindows.find(window) == mKnownWindows.end())
+    if (fields & TaskModel::Outputs)
+        updateVisibility(id);
+
+    if (!onScreen(id))
+        clearChanged(id);
+    else if (fields & TaskModel::States)
+        markChanged(id, TaskButton::Activated);
+    else if (fields & (TaskModel::Title | TaskModel::Icon))
+        markChanged(id, TaskButton::Changed);
+
+    if (mStrip)
     {
-        auto button = new TaskButtonX11(window, this);
-        mLayout.insertWidget(mLayout.count() - 1, button);
-        mKnownWindows[window] = button;
+        mStrip->updateTask(id, fields);
+        return;
     }
-}
 
-void TaskBar::removeWindow(WId window)
-{
-    auto pos = mKnownWindows.find(window);
-    if (pos != mKnownWindows.end())
+    auto pos = mButtons.find(id);
+    if (pos == mButtons.end())
+        return;
+
+    auto button = pos->second;
+
+    if (fields & TaskModel::Title)
+        button->setTitle(mModel.title(id));
+    if (fields & TaskModel::Icon)
+        button->setTaskIcon(mModel.icon(id));
+
+    if (fields & TaskModel::States)
     {
-        auto button = pos->second;
-        mKnownWindows.erase(pos);
-        delete button;
+        button->setChecked(mModel.states(id) & TaskModel::Active);
+
+        // a clicked button checks itself, even if activation fails
+        if (mClickedButton && mClickedButton != button &&
+            !(mModel.states(mClickedButton->id()) & TaskModel::Active))
+        {
+            mClickedButton->setChecked(false);
+        }
+
+        mClickedButton = nullptr;
     }
 }
 
-void TaskBar::onWindowAdded(WId window)
+void TaskBar::updateVisibility(TaskModel::Id id)
 {
-    auto pos = mKnownWindows.find(window);
-    if (pos == mKnownWindows.end() && acceptWindow(window))
-        addWindow(window);
-}
+    bool visible = onScreen(id);
 
-void TaskBar::onActiveWindowChanged(WId window)
-{
-    auto active = mKnownWindows.find(window);
-    if (active == mKnownWindows.end())
+    if (mStrip)
     {
-        KWindowInfo info(window, NET::Properties(), NET::WM2TransientFor);
-        active = mKnownWindows.find(info.transientFor());
+        if (visible && !mStrip->hasTask(id))
+            mStrip->addTask(id);
+        else if (!visible)
+            mStrip->removeTask(id);
     }
-
-    for (auto & pair : mKnownWindows)
+    else if (auto button = findButton(id))
     {
-        if (active == mKnownWindows.end() || pair.second != active->second)
-            pair.second->setChecked(false);
+        button->setVisible(visible);
+        if (!visible)
+            button->clearChanged();
     }
-
-    if (active != mKnownWindows.end())
-        active->second->setChecked(true);
 }
 
-void TaskBar::onWindowChanged(WId window, NET::Properties prop,
-                              NET::Properties2 prop2)
+void TaskBar::markChanged(TaskModel::Id id, TaskButton::Change change)
 {
-    if (prop.testFlag(NET::WMWindowType) || prop.testFlag(NET::WMState) ||
-        prop2.testFlag(NET::WM2TransientFor))
-    {
-        if (acceptWindow(window))
-            addWindow(window);
-        else
-            removeWindow(window);
-    }
+    if (mStrip)
+        mStrip->markChanged(id, change);
+    else if (auto button = findButton(id))
+        button->markChanged(change);
+}
 
-    auto pos = mKnownWindows.find(window);
-    if (pos == mKnownWindows.end())
-        return;
+void TaskBar::clearChanged(TaskModel::Id id)
+{
+    if (mStrip)
+        mStrip->clearChanged(id);
+    else if (auto button = findButton(id))
+        button->clearChanged();
+}
 
-    if (prop.testFlag(NET::WMVisibleName) || prop.testFlag(NET::WMName))
-        pos->second->updateText();
-    if (prop.testFlag(NET::WMIcon))
-        pos->second->updateIcon();
+TaskButton * TaskBar::findButton(TaskModel::Id id) const
+{
+    auto pos = mButtons.find(id);
+    return (pos != mButtons.end()) ? pos->second : nullptr;
 }
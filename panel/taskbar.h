@@ -32,42 +32,51 @@
 #ifndef TASKBAR_H
 #define TASKBAR_H
 
-#include <NETWM>
+#include "taskbutton.h"
+#include "taskmodel.h"
+
 #include <QHBoxLayout>
 #include <QWidget>
 #include <unordered_map>
 
+class MainPanel;
 class Resources;
-class TaskButtonX11;
-class TaskButtonWayland;
-
-struct wl_registry;
-struct zwlr_foreign_toplevel_handle_v1;
-struct zwlr_foreign_toplevel_manager_v1;
+class TaskStrip;
+class X11Thumbnails;
 
+// Taskbar view of TaskModel, with a button for each task (or a single
+// TaskStrip drawing all of them, without any buttons)
 class TaskBar : public QWidget
 {
 public:
-    explicit TaskBar(Resources & res, QWidget * parent);
+    TaskBar(Resources & res, TaskModel & model, MainPanel * panel);
+    ~TaskBar();
 
-    // Wayland-specific
-    void addToplevelManager(wl_registry * registry, uint32_t name,
-                            uint32_t version);
-    void addWindow(zwlr_foreign_toplevel_handle_v1 * handle);
+    // sets the panel's screen, for TaskBarScreen=panel
+    void setScreen(QScreen * screen);
 
 private:
-    // X11-specific
-    bool acceptWindow(WId window) const;
-    void addWindow(WId window);
-    void removeWindow(WId window);
-    void onWindowAdded(WId window);
-    void onActiveWindowChanged(WId window);
-    void onWindowChanged(WId window, NET::Properties prop,
-                         NET::Properties2 prop2);
+    void addTask(TaskModel::Id id);
+    void removeTask(TaskModel::Id id);
+    void updateTask(TaskModel::Id id, int fields);
+    bool onScreen(TaskModel::Id id) const
+    {
+        return !mFilterOutputs || (mModel.outputs(id) & mOutputMask);
+    }
+    void updateVisibility(TaskModel::Id id);
+    void markChanged(TaskModel::Id id, TaskButton::Change change);
+    void clearChanged(TaskModel::Id id);
+    TaskButton * findButton(TaskModel::Id id) const;
 
-    Resources & mRes;
-    std::unordered_map<WId, TaskButtonX11 *> mKnownWindows;
+    TaskModel & mModel;
+    int mListener;
+    bool mFilterOutputs;
+    quint32 mOutputMask = 0;
+    X11Thumbnails * mThumbnails = nullptr; // shared by all panels
+    std::unordered_map<TaskModel::Id, TaskButton *> mButtons;
+    TaskButton * mClickedButton = nullptr;
     QHBoxLayout mLayout;
+    TaskStrip * mStrip = nullptr;
 };
 
 #endif // TASKBAR_H
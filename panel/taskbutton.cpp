@@ -29,19 +29,20 @@
  * END_COMMON_COPYRIGHT_HEADER */
 
 #include "taskbutton.h"
-#include "resources.h"
-#include "wlr-foreign-toplevel-management-unstable-v1.h"
+#include "x11thumbnails.h"
 
-#include <KWindowInfo>
-#include <KX11Extras>
-#include <NETWM>
 #include <QDragEnterEvent>
-#include <QGuiApplication>
-#include <QStyle>
-#include <QTimer>
-#include <private/qtx11extras_p.h>
+#include <QStyleOptionToolButton>
+#include <QStylePainter>
+#include <algorithm>
 
-TaskButton::TaskButton(QWidget * parent) : QToolButton(parent)
+#ifdef QMPANEL_BENCH
+TaskButton::PaintStats TaskButton::paintStats;
+#endif
+
+TaskButton::TaskButton(TaskModel & model, TaskModel::Id id,
+                       X11Thumbnails * thumbnails, QWidget * parent)
+    : QToolButton(parent), mModel(model), mId(id), mThumbnails(thumbnails)
 {
     setCheckable(true);
     setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
@@ -65,174 +66,142 @@ QSize TaskButton::sizeHint() const
     return {2 * logicalDpiX(), QToolButton::sizeHint().height()};
 }
 
-void TaskButton::dragEnterEvent(QDragEnterEvent * event)
+void TaskButton::setTitle(const QString & title)
 {
-    mTimer.start();
-    event->acceptProposedAction();
-    QToolButton::dragEnterEvent(event);
+    mTitle = title;
+    setText(QString(title).replace("&", "&&"));
+    setToolTip(title);
 }
 
-void TaskButton::dragLeaveEvent(QDragLeaveEvent * event)
+void TaskButton::setTaskIcon(QIcon icon)
 {
-    mTimer.stop();
-    QToolButton::dragLeaveEvent(event);
-}
+    if (icon.isNull())
+        icon = style()->standardIcon(QStyle::SP_FileIcon);
 
-void TaskButton::dropEvent(QDropEvent * event)
-{
-    mTimer.stop();
-    QToolButton::dropEvent(event);
+    // icons are shared, so an unchanged icon has the same cacheKey()
+    if (icon.cacheKey() != this->icon().cacheKey())
+        setIcon(icon);
 }
 
-void TaskButton::mousePressEvent(QMouseEvent * event)
+#ifdef QMPANEL_BENCH
+void TaskButton::Latency::mark(qint64 eventTime, Change change)
 {
-    if (event->button() == Qt::MiddleButton)
+    if (!mTime && eventTime)
     {
-        closeWindow();
-        event->accept();
-        return;
+        mTime = eventTime;
+        mChange = change;
     }
-
-    QToolButton::mousePressEvent(event);
 }
 
-TaskButtonX11::TaskButtonX11(const WId window, QWidget * parent)
-    : TaskButton(parent), mWindow(window)
+void TaskButton::Latency::painted()
 {
-    updateText();
-    updateIcon();
+    if (!mTime)
+        return;
 
-    if (KX11Extras::activeWindow() == window)
-        setChecked(true);
+    quint64 latency = std::max(TaskModel::now() - mTime, qint64(0));
+    paintStats.latencies[mChange]++;
+    paintStats.latencyNsecs[mChange] += latency;
+    paintStats.maxLatencyNsecs[mChange] =
+        std::max(paintStats.maxLatencyNsecs[mChange], latency);
+
+    mTime = 0;
 }
+#endif
 
-void TaskButtonX11::updateText()
+// shows a preview (with the title) in place of the tooltip
+bool TaskButton::event(QEvent * event)
 {
-    KWindowInfo info(mWindow, NET::WMVisibleName | NET::WMName);
-    QString title = info.visibleName();
-    if (title.isEmpty())
-        title = info.name();
+    if (event->type() == QEvent::ToolTip && mThumbnails &&
+        mThumbnails->showPreview(mId, mTitle, this))
+    {
+        return true;
+    }
 
-    setText(title.replace("&", "&&"));
-    setToolTip(title);
+    return QToolButton::event(event);
 }
 
-void TaskButtonX11::updateIcon()
+void TaskButton::leaveEvent(QEvent * event)
 {
-    int size = style()->pixelMetric(QStyle::PM_ToolBarIconSize);
-    size *= devicePixelRatioF();
-    QIcon icon = KX11Extras::icon(mWindow, size, size);
-    if (icon.isNull())
-        icon = style()->standardIcon(QStyle::SP_FileIcon);
-    setIcon(icon);
-}
+    if (mThumbnails)
+        mThumbnails->hidePreview();
 
-void TaskButtonX11::activateWindow()
-{
-    KX11Extras::forceActiveWindow(mWindow);
-    // need to flush if called from timer
-    xcb_flush(QX11Info::connection());
+    QToolButton::leaveEvent(event);
 }
 
-void TaskButtonX11::minimizeWindow() { KX11Extras::minimizeWindow(mWindow); }
-
-void TaskButtonX11::closeWindow()
+void TaskButton::dragEnterEvent(QDragEnterEvent * event)
 {
-    NETRootInfo info(QX11Info::connection(), NET::CloseWindow);
-    info.closeWindowRequest(mWindow);
+    mTimer.start();
+    event->acceptProposedAction();
+    QToolButton::dragEnterEvent(event);
 }
 
-TaskButtonWayland::TaskButtonWayland(Resources & res,
-                                     zwlr_foreign_toplevel_handle_v1 * handle,
-                                     QWidget * parent)
-    : TaskButton(parent), mRes(res), mHandle(handle)
+void TaskButton::dragLeaveEvent(QDragLeaveEvent * event)
 {
-    static const zwlr_foreign_toplevel_handle_v1_listener toplevel_handle_impl =
-        {
-            .title =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   const char * title) {
-                    auto self = static_cast<TaskButtonWayland *>(data);
-                    self->setText(QString(title).replace("&", "&&"));
-                    self->setToolTip(title);
-                },
-            .app_id =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   const char * app_id) {
-                    static_cast<TaskButtonWayland *>(data)->setAppName(app_id);
-                },
-            .output_enter =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   wl_output * output) {
-                    /* no-op */
-                },
-            .output_leave =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   wl_output * output) {
-                    /* no-op */
-                },
-            .state =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   wl_array * state) {
-                    auto start = static_cast<const uint32_t *>(state->data);
-                    auto end = start + (state->size / sizeof(uint32_t));
-                    bool activated =
-                        (std::find(
-                             start, end,
-                             ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_ACTIVATED) !=
-                         end);
-                    static_cast<TaskButtonWayland *>(data)->setChecked(
-                        activated);
-                },
-            .done =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle) {
-                    /* no-op */
-                },
-            .closed =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle) {
-                    auto self = static_cast<TaskButtonWayland *>(data);
-                    self->deleteLater();
-                },
-            .parent =
-                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
-                   zwlr_foreign_toplevel_handle_v1 * parent) {
-                    /* no-op */
-                },
-        };
-
-    zwlr_foreign_toplevel_handle_v1_add_listener(handle, &toplevel_handle_impl,
-                                                 this);
-
-    // set default icon (usually changed from app_id callback)
-    setIcon(style()->standardIcon(QStyle::SP_FileIcon));
+    mTimer.stop();
+    QToolButton::dragLeaveEvent(event);
 }
 
-TaskButtonWayland::~TaskButtonWayland()
+void TaskButton::dropEvent(QDropEvent * event)
 {
-    zwlr_foreign_toplevel_handle_v1_destroy(mHandle);
+    mTimer.stop();
+    QToolButton::dropEvent(event);
 }
 
-void TaskButtonWayland::activateWindow()
+void TaskButton::mousePressEvent(QMouseEvent * event)
 {
-    auto waylandApp =
-        qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>();
-    zwlr_foreign_toplevel_handle_v1_unset_minimized(mHandle);
-    zwlr_foreign_toplevel_handle_v1_activate(mHandle, waylandApp->seat());
-}
+    if (mThumbnails)
+        mThumbnails->hidePreview();
 
-void TaskButtonWayland::minimizeWindow()
-{
-    zwlr_foreign_toplevel_handle_v1_set_minimized(mHandle);
-}
+    if (event->button() == Qt::MiddleButton)
+    {
+        closeWindow();
+        event->accept();
+        return;
+    }
 
-void TaskButtonWayland::closeWindow()
-{
-    zwlr_foreign_toplevel_handle_v1_close(mHandle);
+    QToolButton::mousePressEvent(event);
 }
 
-void TaskButtonWayland::setAppName(const QString & appName)
+// Same as QToolButton::paintEvent() except that the title is drawn from
+// a cached layout rather than elided and shaped again on every paint
+void TaskButton::paintEvent(QPaintEvent *)
 {
-    auto icon = mRes.getAppIcon(appName);
-    if (!icon.isNull())
-        setIcon(icon);
+    PaintTimer timer;
+
+    QStylePainter painter(this);
+    QStyleOptionToolButton opt;
+    initStyleOption(&opt);
+    opt.text.clear();
+    painter.drawComplexControl(QStyle::CC_ToolButton, opt);
+
+    // text placement follows QCommonStyle (CC_ToolButton, then
+    // CE_ToolButtonLabel with the text beside the icon)
+    auto style = this->style();
+    int frame = style->pixelMetric(QStyle::PM_DefaultFrameWidth, &opt, this);
+    QRect label = style->subControlRect(QStyle::CC_ToolButton, &opt,
+                                        QStyle::SC_ToolButton, this)
+                      .adjusted(frame, frame, -frame, -frame);
+
+    if (opt.state & (QStyle::State_Sunken | QStyle::State_On))
+    {
+        label.translate(
+            style->pixelMetric(QStyle::PM_ButtonShiftHorizontal, &opt, this),
+            style->pixelMetric(QStyle::PM_ButtonShiftVertical, &opt, this));
+    }
+
+    QRect rect = QStyle::visualRect(
+        opt.direction, label,
+        label.adjusted(opt.iconSize.width() + 4, 0, 0, 0));
+
+    auto & text = mElidedTitle.get(mTitle, rect.width(), font());
+    int width = text.size().width();
+    int x = (opt.direction == Qt::RightToLeft) ? rect.right() + 1 - width
+                                                : rect.left();
+
+    painter.setPen(palette().color(opt.palette.currentColorGroup(),
+                                   QPalette::ButtonText));
+    painter.drawStaticText(
+        x, rect.center().y() - (int)text.size().height() / 2, text);
+
+    mLatency.painted();
 }
@@ -31,67 +31,126 @@
 #ifndef TASKBUTTON_H
 #define TASKBUTTON_H
 
+#include "elidedtext.h"
+#include "taskmodel.h"
+
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QToolButton>
 
-class Resources;
-struct zwlr_foreign_toplevel_handle_v1;
+class X11Thumbnails;
 
+// View of one task in TaskModel. Clicking activates or minimizes the
+// window through the model's backend.
 class TaskButton : public QToolButton
 {
 public:
+    // kinds of change whose latency (from the backend event to the
+    // first paint showing it) is measured
+    enum Change
+    {
+        Added,
+        Changed,   // title or icon
+        Activated, // active state
+        CHANGE_COUNT
+    };
+
+#ifdef QMPANEL_BENCH
+    // totals across all task buttons (or the strip), for --stats
+    struct PaintStats
+    {
+        quint64 paints = 0;
+        quint64 nsecs = 0;
+        quint64 latencies[CHANGE_COUNT] = {};
+        quint64 latencyNsecs[CHANGE_COUNT] = {};
+        quint64 maxLatencyNsecs[CHANGE_COUNT] = {};
+    };
+
+    static PaintStats paintStats;
+
+    // counts a paint, and the time until it goes out of scope
+    class PaintTimer
+    {
+    public:
+        PaintTimer() { mTimer.start(); }
+        ~PaintTimer()
+        {
+            paintStats.paints++;
+            paintStats.nsecs += mTimer.nsecsElapsed();
+        }
+
+    private:
+        QElapsedTimer mTimer;
+    };
+#else
+    class PaintTimer
+    {
+    public:
+        PaintTimer() {} // not trivial, so unused instances are no warning
+    };
+#endif
+
+    // latency of one task's change, until it is painted (also used by
+    // the strip's cells); measured only in benchmark builds
+    class Latency
+    {
+    public:
+#ifdef QMPANEL_BENCH
+        // starts measuring from the given event time, unless an earlier
+        // change is still waiting to be painted
+        void mark(qint64 eventTime, Change change);
+        // stops measuring (e.g. if the task is hidden)
+        void clear() { mTime = 0; }
+        void painted();
+
+    private:
+        qint64 mTime = 0;
+        Change mChange = Added;
+#else
+        void mark(qint64, Change) {}
+        void clear() {}
+        void painted() {}
+#endif
+    };
+
+    // thumbnails is null if not supported
+    TaskButton(TaskModel & model, TaskModel::Id id,
+               X11Thumbnails * thumbnails, QWidget * parent);
+
     QSize sizeHint() const override;
 
-protected:
-    TaskButton(QWidget * parent);
+    TaskModel::Id id() const { return mId; }
+    const QString & title() const { return mTitle; }
+    void setTitle(const QString & title);
+    void setTaskIcon(QIcon icon);
+
+    void markChanged(Change change)
+    {
+        mLatency.mark(mModel.eventTime(), change);
+    }
+    void clearChanged() { mLatency.clear(); }
 
+protected:
+    bool event(QEvent * event) override;
     void dragEnterEvent(QDragEnterEvent * event) override;
     void dragLeaveEvent(QDragLeaveEvent * event) override;
     void dropEvent(QDropEvent * event) override;
+    void leaveEvent(QEvent * event) override;
     void mousePressEvent(QMouseEvent * event) override;
-
-    virtual void activateWindow() = 0;
-    virtual void minimizeWindow() = 0;
-    virtual void closeWindow() = 0;
+    void paintEvent(QPaintEvent *) override;
 
 private:
-    QTimer mTimer;
-};
-
-class TaskButtonX11 : public TaskButton
-{
-public:
-    TaskButtonX11(const WId window, QWidget * parent);
-
-    void updateText();
-    void updateIcon();
+    void activateWindow() { mModel.activate(mId); }
+    void minimizeWindow() { mModel.minimize(mId); }
+    void closeWindow() { mModel.close(mId); }
 
-protected:
-    void activateWindow() override;
-    void minimizeWindow() override;
-    void closeWindow() override;
-
-private:
-    WId const mWindow;
-};
-
-class TaskButtonWayland : public TaskButton
-{
-public:
-    TaskButtonWayland(Resources & res, zwlr_foreign_toplevel_handle_v1 * handle,
-                      QWidget * parent);
-    ~TaskButtonWayland();
-
-protected:
-    void activateWindow() override;
-    void minimizeWindow() override;
-    void closeWindow() override;
-
-private:
-    void setAppName(const QString & appName);
-
-    Resources & mRes;
-    zwlr_foreign_toplevel_handle_v1 * const mHandle;
+    TaskModel & mModel;
+    TaskModel::Id const mId;
+    X11Thumbnails * const mThumbnails;
+    QTimer mTimer;
+    QString mTitle;
+    ElidedText mElidedTitle;
+    Latency mLatency;
 };
 
 #endif // TASKBUTTON_H
@@ -0,0 +1,265 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "taskmodel.h"
+#include "waylandtasks.h"
+#include "x11tasks.h"
+
+#include <QGuiApplication>
+#include <algorithm>
+#include <chrono>
+#include <private/qtx11extras_p.h>
+
+TaskModel::TaskModel(Resources & res)
+{
+    if (QX11Info::isPlatformX11())
+        mBackend.reset(new X11Tasks(*this));
+    else if (qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>())
+        mBackend.reset(new WaylandTasks(res, *this, nullptr));
+}
+
+TaskModel::TaskModel(Resources & res, wl_display * display)
+{
+    mBackend.reset(new WaylandTasks(res, *this, display));
+}
+
+quint32 TaskModel::outputMask(const void * output)
+{
+    if (auto mask = findOutputMask(output))
+        return mask;
+
+    // reuse the slot of a removed output if there is one
+    auto pos = std::find(mOutputIds.begin(), mOutputIds.end(), nullptr);
+    if (pos != mOutputIds.end())
+    {
+        *pos = output;
+        return 1u << (pos - mOutputIds.begin());
+    }
+
+    if (mOutputIds.size() >= 32)
+        return 0;
+
+    mOutputIds.push_back(output);
+    return 1u << (mOutputIds.size() - 1);
+}
+
+quint32 TaskModel::findOutputMask(const void * output) const
+{
+    if (!output)
+        return 0;
+
+    auto pos = std::find(mOutputIds.begin(), mOutputIds.end(), output);
+    return (pos != mOutputIds.end()) ? 1u << (pos - mOutputIds.begin()) : 0;
+}
+
+void TaskModel::releaseOutput(const void * output)
+{
+    auto mask = findOutputMask(output);
+    if (!mask)
+        return;
+
+    for (auto id : std::vector<Id>(mIds))
+        setOutputs(id, outputs(id) & ~mask);
+
+    // the pointer may be reused for a new output
+    *std::find(mOutputIds.begin(), mOutputIds.end(), output) = nullptr;
+}
+
+int TaskModel::addListener(Listener listener)
+{
+    mListeners.emplace_back(mNextListener, std::move(listener));
+    return mNextListener++;
+}
+
+#ifdef QMPANEL_BENCH
+qint64 TaskModel::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+void TaskModel::removeListener(int handle)
+{
+    for (auto it = mListeners.begin(); it != mListeners.end(); ++it)
+    {
+        if (it->first == handle)
+        {
+            mListeners.erase(it);
+            break;
+        }
+    }
+}
+
+void TaskModel::activate(Id id)
+{
+    if (mBackend)
+        mBackend->activate(id);
+}
+
+void TaskModel::minimize(Id id)
+{
+    if (mBackend)
+        mBackend->minimize(id);
+}
+
+void TaskModel::close(Id id)
+{
+    if (mBackend)
+        mBackend->close(id);
+}
+
+X11Thumbnails * TaskModel::thumbnails()
+{
+    return mBackend ? mBackend->thumbnails() : nullptr;
+}
+
+void TaskModel::add(Id id)
+{
+    if (contains(id))
+        return;
+
+    mIndex[id] = mIds.size();
+    mIds.push_back(id);
+    mTitles.emplace_back();
+    mAppIds.emplace_back();
+    mIcons.emplace_back();
+    mStates.push_back(0);
+    mOutputs.push_back(0);
+
+    for (auto & pair : mListeners)
+        pair.second.added(id);
+}
+
+void TaskModel::remove(Id id)
+{
+    auto pos = mIndex.find(id);
+    if (pos == mIndex.end())
+        return;
+
+    for (auto & pair : mListeners)
+        pair.second.removed(id);
+
+    // move the last task into the freed slot (views keep their own order)
+    int index = pos->second;
+    int last = mIds.size() - 1;
+    if (index != last)
+    {
+        mIds[index] = mIds[last];
+        mTitles[index] = std::move(mTitles[last]);
+        mAppIds[index] = std::move(mAppIds[last]);
+        mIcons[index] = std::move(mIcons[last]);
+        mStates[index] = mStates[last];
+        mOutputs[index] = mOutputs[last];
+        mIndex[mIds[index]] = index;
+    }
+
+    mIds.pop_back();
+    mTitles.pop_back();
+    mAppIds.pop_back();
+    mIcons.pop_back();
+    mStates.pop_back();
+    mOutputs.pop_back();
+    mIndex.erase(id);
+}
+
+void TaskModel::setTitle(Id id, const QString & title)
+{
+    int index = find(id);
+    if (index < 0)
+        return; // e.g. a late event for a removed task
+
+    auto & value = mTitles[index];
+    if (value != title)
+    {
+        value = title;
+        notifyChanged(id, Title);
+    }
+}
+
+void TaskModel::setAppId(Id id, const QString & appId)
+{
+    int index = find(id);
+    if (index < 0)
+        return;
+
+    auto & value = mAppIds[index];
+    if (value != appId)
+    {
+        value = appId;
+        notifyChanged(id, AppId);
+    }
+}
+
+void TaskModel::setIcon(Id id, const QIcon & icon)
+{
+    // icons are shared, so an unchanged icon has the same cacheKey()
+    int index = find(id);
+    if (index < 0)
+        return;
+
+    auto & value = mIcons[index];
+    if (value.cacheKey() != icon.cacheKey())
+    {
+        value = icon;
+        notifyChanged(id, Icon);
+    }
+}
+
+void TaskModel::setStates(Id id, int states)
+{
+    int index = find(id);
+    if (index < 0)
+        return;
+
+    auto & value = mStates[index];
+    if (value != states)
+    {
+        value = states;
+        notifyChanged(id, States);
+    }
+}
+
+void TaskModel::setOutputs(Id id, quint32 outputs)
+{
+    int index = find(id);
+    if (index < 0)
+        return;
+
+    auto & value = mOutputs[index];
+    if (value != outputs)
+    {
+        value = outputs;
+        notifyChanged(id, Outputs);
+    }
+}
+
+void TaskModel::notifyChanged(Id id, int fields)
+{
+    for (auto & pair : mListeners)
+        pair.second.changed(id, fields);
+}
@@ -0,0 +1,177 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef TASKMODEL_H
+#define TASKMODEL_H
+
+#include <QIcon>
+#include <QString>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Resources;
+class X11Thumbnails;
+struct wl_display;
+
+// Backend-neutral list of the windows ("tasks") shown in the taskbar.
+// The X11 or Wayland backend writes to the model, and views (such as
+// the taskbar) read from it and are notified of each change. Fields
+// are stored as parallel arrays indexed through a hash of task IDs.
+class TaskModel
+{
+public:
+    using Id = quintptr; // X11 window or Wayland toplevel handle
+
+    enum State
+    {
+        Active = (1 << 0),
+        Minimized = (1 << 1)
+    };
+
+    enum Field
+    {
+        Title = (1 << 0),
+        AppId = (1 << 1),
+        Icon = (1 << 2),
+        States = (1 << 3),
+        Outputs = (1 << 4)
+    };
+
+    struct Listener
+    {
+        std::function<void(Id)> added;
+        std::function<void(Id)> removed;
+        std::function<void(Id, int fields)> changed;
+    };
+
+    struct Stats
+    {
+        quint64 events = 0;  // X11 window events queued
+        quint64 merged = 0;  // events merged into an already queued update
+        quint64 flushes = 0; // batches of X11 or Wayland updates processed
+    };
+
+    // implemented by the X11 and Wayland backends
+    class Backend
+    {
+    public:
+        virtual ~Backend() {}
+        virtual void activate(Id id) = 0;
+        virtual void minimize(Id id) = 0;
+        virtual void close(Id id) = 0;
+        virtual X11Thumbnails * thumbnails() { return nullptr; }
+    };
+
+    explicit TaskModel(Resources & res);
+    // uses the given Wayland display (for benchmarking)
+    TaskModel(Resources & res, wl_display * display);
+
+    const std::vector<Id> & ids() const { return mIds; }
+    bool contains(Id id) const { return mIndex.find(id) != mIndex.end(); }
+
+    const QString & title(Id id) const { return mTitles[index(id)]; }
+    const QString & appId(Id id) const { return mAppIds[index(id)]; }
+    const QIcon & icon(Id id) const { return mIcons[index(id)]; }
+    int states(Id id) const { return mStates[index(id)]; }
+    quint32 outputs(Id id) const { return mOutputs[index(id)]; }
+
+    // a bit for each output (e.g. wl_output) seen so far, up to 32
+    quint32 outputMask(const void * output);
+    // as above, but 0 for an output not seen yet
+    quint32 findOutputMask(const void * output) const;
+    // frees the output's bit and clears it from all tasks
+    void releaseOutput(const void * output);
+
+    int addListener(Listener listener);
+    void removeListener(int handle);
+
+    Stats & stats() { return mStats; }
+
+#ifdef QMPANEL_BENCH
+    // CLOCK_MONOTONIC time (in nanoseconds) of the event that caused the
+    // current change, set by the backend before writing to the model
+    static qint64 now();
+    qint64 eventTime() const { return mEventTime; }
+    void setEventTime(qint64 nsecs) { mEventTime = nsecs; }
+#else
+    // latency is only measured in benchmark builds
+    static qint64 now() { return 0; }
+    qint64 eventTime() const { return 0; }
+    void setEventTime(qint64) {}
+#endif
+
+    void activate(Id id);
+    void minimize(Id id);
+    void close(Id id);
+
+    // window previews, or null if not supported (e.g. Wayland)
+    X11Thumbnails * thumbnails();
+
+    // for use by backends
+    void add(Id id);
+    void remove(Id id);
+    void setTitle(Id id, const QString & title);
+    void setAppId(Id id, const QString & appId);
+    void setIcon(Id id, const QIcon & icon);
+    void setStates(Id id, int states);
+    void setOutputs(Id id, quint32 outputs);
+
+private:
+    // the id must exist (see contains())
+    int index(Id id) const
+    {
+        Q_ASSERT(contains(id));
+        return mIndex.find(id)->second;
+    }
+    // -1 if there is no such task
+    int find(Id id) const
+    {
+        auto pos = mIndex.find(id);
+        return (pos != mIndex.end()) ? pos->second : -1;
+    }
+    void notifyChanged(Id id, int fields);
+
+    std::vector<Id> mIds;
+    std::vector<QString> mTitles;
+    std::vector<QString> mAppIds;
+    std::vector<QIcon> mIcons;
+    std::vector<quint8> mStates;
+    std::vector<quint32> mOutputs;
+    std::unordered_map<Id, int> mIndex;
+
+    std::vector<const void *> mOutputIds;
+    std::vector<std::pair<int, Listener>> mListeners;
+    int mNextListener = 0;
+    Stats mStats;
+#ifdef QMPANEL_BENCH
+    qint64 mEventTime = 0;
+#endif
+    std::unique_ptr<Backend> mBackend; // destroyed first
+};
+
+#endif // TASKMODEL_H
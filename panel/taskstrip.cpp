@@ -0,0 +1,427 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "taskstrip.h"
+#include "mainpanel.h"
+
+#include <QDragEnterEvent>
+#include <QPainter>
+#include <QStyleOptionToolButton>
+#include <QToolTip>
+
+TaskStrip::TaskStrip(TaskModel & model, MainPanel * panel, QWidget * parent)
+    : QWidget(parent), mModel(model), mPanel(panel), mOverflowMenu(this)
+{
+    setAcceptDrops(true);
+    setMouseTracking(true);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+
+    mDragTimer.setSingleShot(true);
+    mDragTimer.setInterval(500);
+
+    connect(&mDragTimer, &QTimer::timeout, [this]() {
+        if (mDragTarget >= 0 && mDragTarget < mShown)
+            mModel.activate(mCells[mDragTarget].id);
+    });
+
+    panel->registerMenu(&mOverflowMenu);
+}
+
+void TaskStrip::addTask(TaskModel::Id id)
+{
+    mCells.push_back({id, QString(), QIcon(), false, ElidedText(), {}});
+    readTask(mCells.back(), TaskModel::Title | TaskModel::Icon |
+                                TaskModel::States);
+
+    if (updateLayout())
+        update();
+    else
+        updateFrom(mCells.size() - 1);
+}
+
+void TaskStrip::removeTask(TaskModel::Id id)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+
+    mCells.erase(mCells.begin() + index);
+
+    mHover = mPressed = mDragTarget = -1;
+    mDragTimer.stop();
+
+    if (updateLayout())
+        update();
+    else
+        updateFrom(index);
+}
+
+void TaskStrip::updateTask(TaskModel::Id id, int fields)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+
+    readTask(mCells[index], fields);
+    update(cellRect(std::min(index, mShown)));
+}
+
+void TaskStrip::markChanged(TaskModel::Id id, TaskButton::Change change)
+{
+    int index = indexOf(id);
+    if (index >= 0)
+        mCells[index].latency.mark(mModel.eventTime(), change);
+}
+
+void TaskStrip::clearChanged(TaskModel::Id id)
+{
+    int index = indexOf(id);
+    if (index >= 0)
+        mCells[index].latency.clear();
+}
+
+void TaskStrip::readTask(Cell & cell, int fields)
+{
+    if (fields & TaskModel::Title)
+        cell.title = mModel.title(cell.id);
+    if (fields & TaskModel::Icon)
+    {
+        cell.icon = mModel.icon(cell.id);
+        if (cell.icon.isNull())
+            cell.icon = style()->standardIcon(QStyle::SP_FileIcon);
+    }
+    if (fields & TaskModel::States)
+        cell.active = mModel.states(cell.id) & TaskModel::Active;
+}
+
+// activates the window, or minimizes it if already active
+void TaskStrip::clickTask(int index)
+{
+    auto & cell = mCells[index];
+    if (cell.active)
+        mModel.minimize(cell.id);
+    else
+        mModel.activate(cell.id);
+}
+
+QSize TaskStrip::sizeHint() const
+{
+    int iconSize = style()->pixelMetric(QStyle::PM_ToolBarIconSize);
+
+    QStyleOptionToolButton opt;
+    opt.initFrom(this);
+    opt.toolButtonStyle = Qt::ToolButtonTextBesideIcon;
+    opt.iconSize = QSize(iconSize, iconSize);
+
+    QSize contents(logicalDpiX(), std::max(iconSize, fontMetrics().height()));
+    return style()->sizeFromContents(QStyle::CT_ToolButton, &opt, contents,
+                                     this);
+}
+
+bool TaskStrip::event(QEvent * event)
+{
+    if (event->type() != QEvent::ToolTip)
+        return QWidget::event(event);
+
+    auto helpEvent = static_cast<QHelpEvent *>(event);
+    int index = cellAt(helpEvent->pos());
+
+    if (index < 0)
+        QToolTip::hideText();
+    else if (index < mShown)
+        QToolTip::showText(helpEvent->globalPos(), mCells[index].title, this,
+                           cellRect(index));
+    else
+    {
+        auto text = QString("%1 more windows").arg(mCells.size() - mShown);
+        QToolTip::showText(helpEvent->globalPos(), text, this,
+                           cellRect(index));
+    }
+
+    return true;
+}
+
+void TaskStrip::paintEvent(QPaintEvent * event)
+{
+    if (mCellWidth <= 0)
+        return;
+
+    TaskButton::PaintTimer timer;
+
+    QPainter painter(this);
+    int first = event->rect().left() / mCellWidth;
+    int last = std::min(event->rect().right() / mCellWidth,
+                        mShown + (hasOverflow() ? 0 : -1));
+
+    for (int i = first; i <= last; i++)
+        paintCell(painter, i);
+}
+
+void TaskStrip::mousePressEvent(QMouseEvent * event)
+{
+    int index = cellAt(event->pos());
+    if (index < 0)
+        return;
+
+    if (index == mShown)
+    {
+        if (event->button() == Qt::LeftButton)
+            showOverflowMenu();
+    }
+    else if (event->button() == Qt::LeftButton)
+    {
+        mPressed = index;
+        update(cellRect(index));
+    }
+    else if (event->button() == Qt::MiddleButton)
+        mModel.close(mCells[index].id);
+
+    event->accept();
+}
+
+void TaskStrip::mouseReleaseEvent(QMouseEvent * event)
+{
+    if (event->button() != Qt::LeftButton || mPressed < 0)
+        return;
+
+    int pressed = mPressed;
+    mPressed = -1;
+    update(cellRect(pressed));
+
+    if (cellAt(event->pos()) == pressed)
+        clickTask(pressed);
+}
+
+void TaskStrip::mouseMoveEvent(QMouseEvent * event)
+{
+    setHover(cellAt(event->pos()));
+}
+
+void TaskStrip::dragEnterEvent(QDragEnterEvent * event)
+{
+    event->acceptProposedAction();
+    dragMoveEvent(event);
+}
+
+void TaskStrip::dragMoveEvent(QDragMoveEvent * event)
+{
+    int index = cellAt(event->position().toPoint());
+    if (index != mDragTarget)
+    {
+        mDragTarget = index;
+        if (index >= 0 && index < mShown)
+            mDragTimer.start();
+        else
+            mDragTimer.stop();
+    }
+
+    event->acceptProposedAction();
+}
+
+void TaskStrip::dragLeaveEvent(QDragLeaveEvent *)
+{
+    mDragTarget = -1;
+    mDragTimer.stop();
+}
+
+void TaskStrip::dropEvent(QDropEvent *)
+{
+    mDragTarget = -1;
+    mDragTimer.stop();
+}
+
+// Returns true if the cell width changed, so that all cells need repainting
+bool TaskStrip::updateLayout()
+{
+    int count = mCells.size();
+    int maxWidth = 2 * logicalDpiX();
+    int fit = std::max(width() / logicalDpiX(), 1);
+
+    int oldWidth = mCellWidth;
+
+    if (count <= fit)
+    {
+        mShown = count;
+        mCellWidth = count ? std::min(maxWidth, width() / count) : maxWidth;
+    }
+    else
+    {
+        mShown = fit - 1; // last cell opens the overflow menu
+        mCellWidth = width() / fit;
+    }
+
+    return mCellWidth != oldWidth;
+}
+
+QRect TaskStrip::cellRect(int index) const
+{
+    return QRect(index * mCellWidth, 0, mCellWidth, height());
+}
+
+int TaskStrip::cellAt(const QPoint & pos) const
+{
+    if (mCellWidth <= 0 || pos.x() < 0)
+        return -1;
+
+    int index = pos.x() / mCellWidth;
+    if (index < mShown || (index == mShown && hasOverflow()))
+        return index;
+
+    return -1;
+}
+
+int TaskStrip::indexOf(TaskModel::Id id) const
+{
+    for (int i = 0; i < (int)mCells.size(); i++)
+    {
+        if (mCells[i].id == id)
+            return i;
+    }
+
+    return -1;
+}
+
+// Repaints the given cell and the ones after it (which have shifted),
+// including the overflow cell if any
+void TaskStrip::updateFrom(int index)
+{
+    index = std::min(index, mShown);
+    update(QRect(index * mCellWidth, 0, width(), height()));
+}
+
+void TaskStrip::setHover(int index)
+{
+    if (index != mHover)
+    {
+        if (mHover >= 0)
+            update(cellRect(mHover));
+        if (index >= 0)
+            update(cellRect(index));
+
+        mHover = index;
+    }
+}
+
+void TaskStrip::paintCell(QPainter & painter, int index)
+{
+    bool overflow = (index == mShown);
+    bool checked = false;
+
+    if (overflow)
+    {
+        for (int i = mShown; i < (int)mCells.size(); i++)
+            checked = checked || mCells[i].active;
+    }
+    else
+        checked = mCells[index].active;
+
+    // same state flags as QToolButton::initStyleOption()
+    QStyleOptionToolButton opt;
+    opt.initFrom(this);
+    opt.rect = cellRect(index);
+    opt.subControls = QStyle::SC_ToolButton;
+    opt.toolButtonStyle = Qt::ToolButtonTextBesideIcon;
+    opt.state &= ~(QStyle::State_MouseOver | QStyle::State_HasFocus);
+
+    if (index == mHover)
+        opt.state |= QStyle::State_MouseOver;
+    if (index == mPressed)
+    {
+        opt.state |= QStyle::State_Sunken;
+        opt.activeSubControls = QStyle::SC_ToolButton;
+    }
+    if (checked)
+        opt.state |= QStyle::State_On;
+    else if (index != mPressed)
+        opt.state |= QStyle::State_Raised;
+
+    // draws only the frame, since text and icon are empty
+    style()->drawComplexControl(QStyle::CC_ToolButton, &opt, &painter, this);
+
+    int margin = style()->pixelMetric(QStyle::PM_ButtonMargin, &opt, this);
+    QRect contents = opt.rect.adjusted(margin, 0, -margin, 0);
+    painter.setPen(palette().color(opt.palette.currentColorGroup(),
+                                   QPalette::ButtonText));
+
+    if (overflow)
+    {
+        painter.drawText(contents, Qt::AlignCenter,
+                         QString("» %1").arg(mCells.size() - mShown));
+
+        // changes to tasks in the overflow menu are shown only here
+        for (int i = mShown; i < (int)mCells.size(); i++)
+            mCells[i].latency.painted();
+
+        return;
+    }
+
+    auto & cell = mCells[index];
+    // the size the icons were decoded at (as for a QToolButton)
+    int iconSize = style()->pixelMetric(QStyle::PM_ToolBarIconSize);
+    int textOffset = iconSize + margin / 2;
+
+    // mirrored for right-to-left layouts
+    QRect iconRect = QStyle::visualRect(
+        opt.direction, contents,
+        QRect(contents.left(), contents.center().y() - iconSize / 2,
+              iconSize, iconSize));
+    QRect textRect = QStyle::visualRect(
+        opt.direction, contents, contents.adjusted(textOffset, 0, 0, 0));
+
+    cell.icon.paint(&painter, iconRect);
+
+    auto & text = cell.text.get(cell.title, textRect.width(), font());
+    int width = text.size().width();
+    int x = (opt.direction == Qt::RightToLeft) ? textRect.right() + 1 - width
+                                                : textRect.left();
+    painter.drawStaticText(
+        x, textRect.center().y() - (int)text.size().height() / 2, text);
+
+    cell.latency.painted();
+}
+
+void TaskStrip::showOverflowMenu()
+{
+    mOverflowMenu.clear();
+
+    for (int i = mShown; i < (int)mCells.size(); i++)
+    {
+        auto & cell = mCells[i];
+        auto action = mOverflowMenu.addAction(
+            cell.icon, QString(cell.title).replace("&", "&&"));
+        action->setCheckable(true);
+        action->setChecked(cell.active);
+
+        // the window may be gone by the time the menu is used
+        auto id = cell.id;
+        connect(action, &QAction::triggered, [this, id]() {
+            if (mModel.contains(id))
+                mModel.activate(id);
+        });
+    }
+
+    mPanel->popupMenu(&mOverflowMenu, cellRect(mShown));
+}
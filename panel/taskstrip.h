@@ -0,0 +1,109 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef TASKSTRIP_H
+#define TASKSTRIP_H
+
+#include "elidedtext.h"
+#include "taskbutton.h"
+
+#include <QMenu>
+#include <QTimer>
+#include <QWidget>
+#include <vector>
+
+class MainPanel;
+
+// Alternative taskbar view (TaskBarMode=strip) for hundreds of windows.
+// Instead of a button per window, this single widget keeps a flat array
+// of the tasks shown and paints them as equally sized cells, so adding a
+// window does not re-layout the others. Windows that don't fit are
+// listed in an overflow menu.
+class TaskStrip : public QWidget
+{
+public:
+    TaskStrip(TaskModel & model, MainPanel * panel, QWidget * parent);
+
+    void addTask(TaskModel::Id id);
+    void removeTask(TaskModel::Id id);
+    // re-reads the given fields (TaskModel::Field) from the model
+    void updateTask(TaskModel::Id id, int fields);
+    bool hasTask(TaskModel::Id id) const { return indexOf(id) >= 0; }
+
+    void markChanged(TaskModel::Id id, TaskButton::Change change);
+    void clearChanged(TaskModel::Id id);
+
+    QSize sizeHint() const override;
+
+protected:
+    bool event(QEvent * event) override;
+    void paintEvent(QPaintEvent * event) override;
+    void resizeEvent(QResizeEvent *) override { updateLayout(); }
+    void mousePressEvent(QMouseEvent * event) override;
+    void mouseReleaseEvent(QMouseEvent * event) override;
+    void mouseMoveEvent(QMouseEvent * event) override;
+    void leaveEvent(QEvent *) override { setHover(-1); }
+    void dragEnterEvent(QDragEnterEvent * event) override;
+    void dragMoveEvent(QDragMoveEvent * event) override;
+    void dragLeaveEvent(QDragLeaveEvent *) override;
+    void dropEvent(QDropEvent *) override;
+
+private:
+    struct Cell
+    {
+        TaskModel::Id id;
+        QString title;
+        QIcon icon;
+        bool active;
+        ElidedText text;
+        TaskButton::Latency latency;
+    };
+
+    bool hasOverflow() const { return mShown < (int)mCells.size(); }
+    bool updateLayout();
+    QRect cellRect(int index) const;
+    int cellAt(const QPoint & pos) const;
+    int indexOf(TaskModel::Id id) const;
+    void readTask(Cell & cell, int fields);
+    void clickTask(int index);
+    void updateFrom(int index);
+    void setHover(int index);
+    void paintCell(QPainter & painter, int index);
+    void showOverflowMenu();
+
+    TaskModel & mModel;
+    MainPanel * const mPanel;
+    std::vector<Cell> mCells;
+    int mShown = 0; // the rest are in the overflow menu
+    int mCellWidth = 0;
+    int mHover = -1;
+    int mPressed = -1;
+    int mDragTarget = -1;
+    QTimer mDragTimer;
+    QMenu mOverflowMenu;
+};
+
+#endif // TASKSTRIP_H
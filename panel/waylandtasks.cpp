@@ -0,0 +1,444 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "waylandtasks.h"
+#include "resources.h"
+#include "wlr-foreign-toplevel-management-unstable-v1.h"
+
+#include <QAbstractEventDispatcher>
+#include <QDebug>
+#include <QGuiApplication>
+#include <QScreen>
+#include <algorithm>
+#include <qpa/qplatformnativeinterface.h>
+#include <string.h>
+
+// how long to keep stale tasks if no new manager appears
+static constexpr int staleTimeout = 5000; // ms
+
+WaylandTasks::WaylandTasks(Resources & res, TaskModel & model,
+                           wl_display * display)
+    : mRes(res), mModel(model)
+{
+    static const wl_registry_listener registry_listener_impl = {
+        .global =
+            [](void * data, wl_registry * registry, uint32_t name,
+               const char * interface, uint32_t version) {
+                auto self = static_cast<WaylandTasks *>(data);
+                if (!strcmp(interface,
+                            zwlr_foreign_toplevel_manager_v1_interface.name))
+                    self->bindManager(registry, name, version);
+            },
+        .global_remove =
+            [](void * data, wl_registry * registry, uint32_t name) {
+                auto self = static_cast<WaylandTasks *>(data);
+                if (self->mManager && name == self->mManagerName)
+                    self->releaseManager();
+            }};
+
+    mStaleTimer.setSingleShot(true);
+    mStaleTimer.setInterval(staleTimeout);
+    QObject::connect(&mStaleTimer, &QTimer::timeout,
+                     [this]() { removeStaleTasks(); });
+
+    if (display)
+    {
+        mDisplay = display;
+        mReadNotifier.reset(new QSocketNotifier(wl_display_get_fd(display),
+                                                QSocketNotifier::Read));
+        QObject::connect(mReadNotifier.get(), &QSocketNotifier::activated,
+                         [this]() { readEvents(); });
+    }
+    else
+    {
+        auto waylandApp =
+            qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>();
+        mDisplay = waylandApp->display();
+
+        // Qt's wl_output for a removed screen is destroyed, and its
+        // address may be reused for the next one
+        mScreenConnection = QObject::connect(
+            qGuiApp, &QGuiApplication::screenRemoved, [this](QScreen * s) {
+                auto native = QGuiApplication::platformNativeInterface();
+                mModel.releaseOutput(
+                    native->nativeResourceForScreen("output", s));
+            });
+    }
+
+    mQueue = wl_display_create_queue(mDisplay);
+
+    // Objects inherit the queue of the object that created them, so the
+    // registry, manager and toplevel handles all use mQueue.
+    mQueueDisplay =
+        static_cast<wl_display *>(wl_proxy_create_wrapper(mDisplay));
+    wl_proxy_set_queue((wl_proxy *)mQueueDisplay, mQueue);
+
+    mRegistry = wl_display_get_registry(mQueueDisplay);
+    wl_registry_add_listener(mRegistry, &registry_listener_impl, this);
+
+    // Qt reads events for all queues but dispatches only its own. Ours
+    // is dispatched each time the main loop goes idle, or (if it was
+    // dispatched less than a frame ago) once that frame has passed.
+    mDispatchTimer.setSingleShot(true);
+    QObject::connect(&mDispatchTimer, &QTimer::timeout,
+                     [this]() { dispatchQueue(); });
+
+    mIdleConnection = QObject::connect(
+        QAbstractEventDispatcher::instance(),
+        &QAbstractEventDispatcher::aboutToBlock, [this]() {
+            if (mReadNotifier)
+                wl_display_flush(mDisplay);
+            if (mDispatchTimer.isActive())
+                return;
+
+            auto screen = QGuiApplication::primaryScreen();
+            qreal rate = screen ? screen->refreshRate() : 60;
+            int frame = 1000 / std::max(rate, qreal(1));
+            int wait = mLastDispatch.isValid()
+                           ? frame - mLastDispatch.elapsed()
+                           : 0;
+
+            if (wait > 0)
+                mDispatchTimer.start(wait);
+            else
+                dispatchQueue();
+        });
+}
+
+WaylandTasks::~WaylandTasks()
+{
+    if (mManager)
+        zwlr_foreign_toplevel_manager_v1_stop(mManager);
+
+    QObject::disconnect(mIdleConnection);
+    QObject::disconnect(mScreenConnection);
+
+    releaseManager();
+    removeStaleTasks();
+    wl_registry_destroy(mRegistry);
+    wl_proxy_wrapper_destroy(mQueueDisplay);
+    wl_event_queue_destroy(mQueue);
+}
+
+void WaylandTasks::readEvents()
+{
+    // reading is only possible once the queue has been dispatched
+    while (wl_display_prepare_read_queue(mDisplay, mQueue) != 0)
+        dispatchQueue();
+
+    if (wl_display_read_events(mDisplay) < 0)
+    {
+        qWarning() << "Lost connection to Wayland display";
+        mReadNotifier->setEnabled(false);
+    }
+}
+
+void WaylandTasks::dispatchQueue()
+{
+    // returns the number of events dispatched
+    if (wl_display_dispatch_queue_pending(mDisplay, mQueue) > 0)
+    {
+        mLastDispatch.start();
+        mModel.stats().flushes++;
+    }
+}
+
+void WaylandTasks::activate(TaskModel::Id id)
+{
+    auto pos = mHandles.find(id);
+    if (pos == mHandles.end())
+        return; // stale task
+
+    auto waylandApp =
+        qGuiApp->nativeInterface<QNativeInterface::QWaylandApplication>();
+    if (!waylandApp)
+        return; // no seat
+
+    zwlr_foreign_toplevel_handle_v1_unset_minimized(pos->second);
+    zwlr_foreign_toplevel_handle_v1_activate(pos->second, waylandApp->seat());
+}
+
+void WaylandTasks::minimize(TaskModel::Id id)
+{
+    auto pos = mHandles.find(id);
+    if (pos != mHandles.end())
+        zwlr_foreign_toplevel_handle_v1_set_minimized(pos->second);
+}
+
+void WaylandTasks::close(TaskModel::Id id)
+{
+    auto pos = mHandles.find(id);
+    if (pos != mHandles.end())
+        zwlr_foreign_toplevel_handle_v1_close(pos->second);
+}
+
+void WaylandTasks::bindManager(wl_registry * registry, uint32_t name,
+                               uint32_t version)
+{
+    if (mManager)
+        return;
+
+    version = std::min<uint32_t>(
+        version, zwlr_foreign_toplevel_manager_v1_interface.version);
+    mManager = static_cast<zwlr_foreign_toplevel_manager_v1 *>(
+        wl_registry_bind(registry, name,
+                         &zwlr_foreign_toplevel_manager_v1_interface, version));
+    if (!mManager)
+    {
+        qWarning()
+            << "Could not bind zwlr_foreign_toplevel_manager_v1_interface";
+        return;
+    }
+
+    mManagerName = name;
+
+    static const zwlr_foreign_toplevel_manager_v1_listener
+        toplevel_manager_impl = {
+            .toplevel =
+                [](void * data, zwlr_foreign_toplevel_manager_v1 * manager,
+                   zwlr_foreign_toplevel_handle_v1 * handle) {
+                    static_cast<WaylandTasks *>(data)->addToplevel(handle);
+                },
+            .finished =
+                [](void * data, zwlr_foreign_toplevel_manager_v1 * manager) {
+                    static_cast<WaylandTasks *>(data)->releaseManager();
+                },
+        };
+
+    zwlr_foreign_toplevel_manager_v1_add_listener(mManager,
+                                                  &toplevel_manager_impl, this);
+
+    if (mStaleTasks.empty())
+        return;
+
+    // The new manager announces all existing toplevels right away. Once
+    // they have been received, any stale tasks left over are gone.
+    static const wl_callback_listener sync_impl = {
+        .done =
+            [](void * data, wl_callback * callback, uint32_t) {
+                auto self = static_cast<WaylandTasks *>(data);
+                wl_callback_destroy(callback);
+                self->mSyncCallback = nullptr;
+                self->removeStaleTasks();
+            },
+    };
+
+    mStaleTimer.stop();
+    mSyncCallback = wl_display_sync(mQueueDisplay);
+    wl_callback_add_listener(mSyncCallback, &sync_impl, this);
+}
+
+// Called when the manager is removed or finished, and at exit. Tasks
+// are kept (as stale) in case a new manager appears.
+void WaylandTasks::releaseManager()
+{
+    for (auto & pair : mToplevels)
+    {
+        auto toplevel = pair.second.get();
+        if (toplevel->id)
+        {
+            mHandles.erase(toplevel->id);
+            mStaleTasks.insert(toplevel->id);
+        }
+
+        zwlr_foreign_toplevel_handle_v1_destroy(toplevel->handle);
+    }
+
+    mToplevels.clear();
+
+    if (mSyncCallback)
+    {
+        wl_callback_destroy(mSyncCallback);
+        mSyncCallback = nullptr;
+    }
+
+    if (mManager)
+    {
+        zwlr_foreign_toplevel_manager_v1_destroy(mManager);
+        mManager = nullptr;
+        mManagerName = 0;
+    }
+
+    if (!mStaleTasks.empty())
+        mStaleTimer.start();
+}
+
+void WaylandTasks::addToplevel(zwlr_foreign_toplevel_handle_v1 * handle)
+{
+    static const zwlr_foreign_toplevel_handle_v1_listener toplevel_handle_impl =
+        {
+            .title =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   const char * title) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->pending.title = QString(title);
+                },
+            .app_id =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   const char * app_id) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->pending.appId = QString(app_id);
+                },
+            .output_enter =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   wl_output * output) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->pending.outputs.emplace_back(output, true);
+                },
+            .output_leave =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   wl_output * output) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->pending.outputs.emplace_back(output, false);
+                },
+            .state =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   wl_array * state) {
+                    auto start = static_cast<const uint32_t *>(state->data);
+                    auto end = start + (state->size / sizeof(uint32_t));
+                    auto activated =
+                        ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_ACTIVATED;
+                    auto minimized =
+                        ZWLR_FOREIGN_TOPLEVEL_HANDLE_V1_STATE_MINIMIZED;
+                    int states = 0;
+                    if (std::find(start, end, activated) != end)
+                        states |= TaskModel::Active;
+                    if (std::find(start, end, minimized) != end)
+                        states |= TaskModel::Minimized;
+
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->pending.states = states;
+                },
+            .done =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->tasks->applyPending(toplevel);
+                },
+            .closed =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle) {
+                    auto toplevel = static_cast<Toplevel *>(data);
+                    toplevel->tasks->removeToplevel(toplevel);
+                },
+            .parent =
+                [](void * data, zwlr_foreign_toplevel_handle_v1 * handle,
+                   zwlr_foreign_toplevel_handle_v1 * parent) {
+                    /* no-op */
+                },
+        };
+
+    auto toplevel = new Toplevel{this, handle};
+    mToplevels.emplace(handle, toplevel);
+    zwlr_foreign_toplevel_handle_v1_add_listener(handle, &toplevel_handle_impl,
+                                                 toplevel);
+}
+
+// Toplevel state is double-buffered: the compositor sends any number of
+// changes followed by "done", and they take effect together. The task
+// is added to the model on the first "done", with its initial state.
+void WaylandTasks::applyPending(Toplevel * toplevel)
+{
+    auto & pending = toplevel->pending;
+    mModel.setEventTime(TaskModel::now());
+
+    if (!toplevel->id)
+    {
+        toplevel->id = takeStaleTask(pending);
+        if (!toplevel->id)
+        {
+            toplevel->id = mNextId++;
+            mModel.add(toplevel->id);
+        }
+
+        mHandles[toplevel->id] = toplevel->handle;
+    }
+
+    auto id = toplevel->id;
+
+    if (pending.title)
+        mModel.setTitle(id, *pending.title);
+
+    if (pending.appId && *pending.appId != mModel.appId(id))
+    {
+        mModel.setAppId(id, *pending.appId);
+        auto icon = mRes.getAppIcon(*pending.appId);
+        if (!icon.isNull())
+            mModel.setIcon(id, icon);
+    }
+
+    if (pending.states)
+        mModel.setStates(id, *pending.states);
+
+    quint32 outputs = mModel.outputs(id);
+    for (auto [output, entered] : pending.outputs)
+    {
+        if (entered)
+            outputs |= mModel.outputMask(output);
+        else
+            outputs &= ~mModel.findOutputMask(output);
+    }
+
+    mModel.setOutputs(id, outputs);
+    pending = Pending();
+}
+
+void WaylandTasks::removeToplevel(Toplevel * toplevel)
+{
+    auto handle = toplevel->handle;
+    if (toplevel->id)
+    {
+        mHandles.erase(toplevel->id);
+        mModel.remove(toplevel->id);
+    }
+
+    mToplevels.erase(handle); // deletes toplevel
+    zwlr_foreign_toplevel_handle_v1_destroy(handle);
+}
+
+// Returns a stale task with the same app_id and title, or 0
+TaskModel::Id WaylandTasks::takeStaleTask(const Pending & pending)
+{
+    for (auto id : mStaleTasks)
+    {
+        if (pending.appId.value_or(QString()) == mModel.appId(id) &&
+            pending.title.value_or(QString()) == mModel.title(id))
+        {
+            mStaleTasks.erase(id);
+            return id;
+        }
+    }
+
+    return 0;
+}
+
+void WaylandTasks::removeStaleTasks()
+{
+    mStaleTimer.stop();
+
+    for (auto id : mStaleTasks)
+        mModel.remove(id);
+
+    mStaleTasks.clear();
+}
@@ -0,0 +1,125 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef WAYLANDTASKS_H
+#define WAYLANDTASKS_H
+
+#include "taskmodel.h"
+
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Resources;
+
+struct wl_callback;
+struct wl_display;
+struct wl_event_queue;
+struct wl_output;
+struct wl_registry;
+struct zwlr_foreign_toplevel_handle_v1;
+struct zwlr_foreign_toplevel_manager_v1;
+
+// Wayland backend for TaskModel (wlr-foreign-toplevel-management).
+//
+// If the compositor removes the toplevel manager (e.g. restarting it),
+// existing tasks are kept as "stale" until a new manager appears. New
+// toplevels matching a stale task (by app_id and title) then take over
+// that task, so that its button is kept in place.
+//
+// All toplevel events go to a separate event queue, dispatched at most
+// once per frame when the main loop is idle, so that a flood of them
+// (e.g. at session restore) does not delay input or rendering.
+class WaylandTasks : public TaskModel::Backend
+{
+public:
+    // display is null for Qt's own connection; others (e.g. in the
+    // benchmark harness) are read and flushed here as well
+    WaylandTasks(Resources & res, TaskModel & model, wl_display * display);
+    ~WaylandTasks();
+
+    void activate(TaskModel::Id id) override;
+    void minimize(TaskModel::Id id) override;
+    void close(TaskModel::Id id) override;
+
+private:
+    // changes received since the last "done" event
+    struct Pending
+    {
+        std::optional<QString> title;
+        std::optional<QString> appId;
+        std::optional<int> states;
+        std::vector<std::pair<wl_output *, bool>> outputs; // entered/left
+    };
+
+    struct Toplevel
+    {
+        WaylandTasks * tasks;
+        zwlr_foreign_toplevel_handle_v1 * handle;
+        TaskModel::Id id = 0; // assigned on the first "done" event
+        Pending pending;
+    };
+
+    void readEvents();
+    void dispatchQueue();
+    void bindManager(wl_registry * registry, uint32_t name, uint32_t version);
+    void releaseManager();
+    void addToplevel(zwlr_foreign_toplevel_handle_v1 * handle);
+    void applyPending(Toplevel * toplevel);
+    void removeToplevel(Toplevel * toplevel);
+    TaskModel::Id takeStaleTask(const Pending & pending);
+    void removeStaleTasks();
+
+    Resources & mRes;
+    TaskModel & mModel;
+    wl_display * mDisplay;
+    wl_event_queue * mQueue;
+    wl_display * mQueueDisplay; // wrapper for creating objects on mQueue
+    QMetaObject::Connection mIdleConnection;
+    QMetaObject::Connection mScreenConnection; // Qt's display only
+    std::unique_ptr<QSocketNotifier> mReadNotifier; // not Qt's display
+    QTimer mDispatchTimer;
+    QElapsedTimer mLastDispatch;
+    wl_registry * mRegistry = nullptr;
+    zwlr_foreign_toplevel_manager_v1 * mManager = nullptr;
+    uint32_t mManagerName = 0;
+    wl_callback * mSyncCallback = nullptr;
+    std::unordered_map<zwlr_foreign_toplevel_handle_v1 *,
+                       std::unique_ptr<Toplevel>>
+        mToplevels;
+    std::unordered_map<TaskModel::Id, zwlr_foreign_toplevel_handle_v1 *>
+        mHandles;
+    std::unordered_set<TaskModel::Id> mStaleTasks;
+    TaskModel::Id mNextId = 1;
+    QTimer mStaleTimer;
+};
+
+#endif // WAYLANDTASKS_H
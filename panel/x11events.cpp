@@ -0,0 +1,205 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11events.h"
+#include "x11props.h"
+
+#include <QCoreApplication>
+#include <private/qtx11extras_p.h>
+#include <stdlib.h>
+
+bool X11EventFilter::isEnabled()
+{
+    return qgetenv("QMPANEL_X11_EVENTS") == "xcb";
+}
+
+static xcb_get_property_cookie_t requestRootProperty(X11Atom atom)
+{
+    return xcb_get_property(QX11Info::connection(), false,
+                            QX11Info::appRootWindow(), getX11Atom(atom),
+                            XCB_ATOM_WINDOW, 0, 65536);
+}
+
+static QList<WId> getWindowList(xcb_get_property_cookie_t cookie)
+{
+    QList<WId> windows;
+    auto reply =
+        xcb_get_property_reply(QX11Info::connection(), cookie, nullptr);
+
+    if (reply && reply->format == 32)
+    {
+        auto data =
+            static_cast<const xcb_window_t *>(xcb_get_property_value(reply));
+        int count = xcb_get_property_value_length(reply) / 4;
+        for (int i = 0; i < count; i++)
+            windows.append(data[i]);
+    }
+
+    free(reply);
+    return windows;
+}
+
+// Adds PropertyChangeMask to the events already selected by this client.
+// Qt's own windows (e.g. the panel) may be listed and need their masks.
+static void selectPropertyEvents(const QList<WId> & windows)
+{
+    auto conn = QX11Info::connection();
+    std::vector<xcb_get_window_attributes_cookie_t> cookies;
+    for (WId window : windows)
+        cookies.push_back(xcb_get_window_attributes(conn, window));
+
+    if (!windows.isEmpty())
+        countX11RoundTrip();
+
+    for (int i = 0; i < windows.size(); i++)
+    {
+        xcb_generic_error_t * error = nullptr;
+        auto reply = xcb_get_window_attributes_reply(conn, cookies[i], &error);
+        uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+
+        if (reply && !(reply->your_event_mask & mask))
+        {
+            mask |= reply->your_event_mask;
+            xcb_change_window_attributes(conn, windows[i], XCB_CW_EVENT_MASK,
+                                         &mask);
+        }
+
+        free(reply);
+        free(error);
+    }
+}
+
+X11EventFilter::X11EventFilter(Handlers handlers)
+    : mHandlers(std::move(handlers))
+{
+    selectPropertyEvents({(WId)QX11Info::appRootWindow()});
+
+    auto stackingCookie = requestRootProperty(NET_CLIENT_LIST_STACKING);
+    auto activeCookie = requestRootProperty(NET_ACTIVE_WINDOW);
+
+    countX11RoundTrip();
+    mStackingOrder = getWindowList(stackingCookie);
+    auto active = getWindowList(activeCookie);
+    mActiveWindow = active.isEmpty() ? 0 : active[0];
+
+    selectPropertyEvents(mStackingOrder);
+    mClients.insert(mStackingOrder.begin(), mStackingOrder.end());
+
+    QCoreApplication::instance()->installNativeEventFilter(this);
+}
+
+X11EventFilter::~X11EventFilter()
+{
+    QCoreApplication::instance()->removeNativeEventFilter(this);
+}
+
+bool X11EventFilter::nativeEventFilter(const QByteArray & eventType,
+                                       void * message, qintptr *)
+{
+    if (eventType != "xcb_generic_event_t")
+        return false;
+
+    auto event = static_cast<xcb_generic_event_t *>(message);
+    if ((event->response_type & ~0x80) != XCB_PROPERTY_NOTIFY)
+        return false;
+
+    auto notify = reinterpret_cast<xcb_property_notify_event_t *>(event);
+    auto atom = notify->atom;
+
+    if (notify->window == QX11Info::appRootWindow())
+    {
+        if (atom == getX11Atom(NET_CLIENT_LIST))
+            updateClientList();
+        else if (atom == getX11Atom(NET_ACTIVE_WINDOW))
+            updateActiveWindow();
+
+        return false;
+    }
+
+    if (mClients.find(notify->window) == mClients.end())
+        return false;
+
+    NET::Properties prop;
+    NET::Properties2 prop2;
+
+    if (atom == getX11Atom(NET_WM_NAME) || atom == XCB_ATOM_WM_NAME)
+        prop = NET::WMName;
+    else if (atom == getX11Atom(NET_WM_VISIBLE_NAME))
+        prop = NET::WMVisibleName;
+    else if (atom == getX11Atom(NET_WM_ICON))
+        prop = NET::WMIcon;
+    else if (atom == getX11Atom(NET_WM_STATE))
+        prop = NET::WMState;
+    else if (atom == getX11Atom(NET_WM_WINDOW_TYPE))
+        prop = NET::WMWindowType;
+    else if (atom == XCB_ATOM_WM_TRANSIENT_FOR)
+        prop2 = NET::WM2TransientFor;
+    else
+        return false;
+
+    mHandlers.windowChanged(notify->window, prop, prop2);
+    return false;
+}
+
+void X11EventFilter::updateClientList()
+{
+    countX11RoundTrip();
+    auto windows = getWindowList(requestRootProperty(NET_CLIENT_LIST));
+    std::unordered_set<WId> clients(windows.begin(), windows.end());
+
+    QList<WId> added, removed;
+    for (WId window : windows)
+    {
+        if (mClients.find(window) == mClients.end())
+            added.append(window);
+    }
+    for (WId window : mClients)
+    {
+        if (clients.find(window) == clients.end())
+            removed.append(window);
+    }
+
+    mClients = std::move(clients);
+    selectPropertyEvents(added);
+
+    for (WId window : removed)
+        mHandlers.windowRemoved(window);
+    for (WId window : added)
+        mHandlers.windowAdded(window);
+}
+
+void X11EventFilter::updateActiveWindow()
+{
+    countX11RoundTrip();
+    auto active = getWindowList(requestRootProperty(NET_ACTIVE_WINDOW));
+    WId window = active.isEmpty() ? 0 : active[0];
+
+    if (window != mActiveWindow)
+    {
+        mActiveWindow = window;
+        mHandlers.activeWindowChanged(window);
+    }
+}
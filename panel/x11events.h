@@ -0,0 +1,73 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11EVENTS_H
+#define X11EVENTS_H
+
+#include <NETWM>
+#include <QAbstractNativeEventFilter>
+#include <QList>
+#include <functional>
+#include <unordered_set>
+
+// Alternative to the KX11Extras signals for the X11 taskbar. Only the
+// properties used by the taskbar are watched, and PropertyNotify events
+// are decoded directly from the xcb event stream. Enabled by setting
+// QMPANEL_X11_EVENTS=xcb in the environment.
+class X11EventFilter : public QAbstractNativeEventFilter
+{
+public:
+    struct Handlers
+    {
+        std::function<void(WId)> windowAdded;
+        std::function<void(WId)> windowRemoved;
+        std::function<void(WId)> activeWindowChanged;
+        std::function<void(WId, NET::Properties, NET::Properties2)>
+            windowChanged;
+    };
+
+    static bool isEnabled();
+
+    explicit X11EventFilter(Handlers handlers);
+    ~X11EventFilter();
+
+    const QList<WId> & stackingOrder() const { return mStackingOrder; }
+    WId activeWindow() const { return mActiveWindow; }
+
+    bool nativeEventFilter(const QByteArray & eventType, void * message,
+                           qintptr * result) override;
+
+private:
+    void updateClientList();
+    void updateActiveWindow();
+
+    Handlers mHandlers;
+    QList<WId> mStackingOrder; // at startup only
+    std::unordered_set<WId> mClients;
+    WId mActiveWindow = 0;
+};
+
+#endif // X11EVENTS_H
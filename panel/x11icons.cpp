@@ -0,0 +1,367 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11icons.h"
+#include "x11props.h"
+
+#include <KX11Extras>
+#include <QCache>
+#include <QPixmap>
+#include <private/qtx11extras_p.h>
+#include <stdlib.h>
+#include <string.h>
+
+// _NET_WM_ICON often contains many sizes (up to 512x512 or more), so it
+// is not read all at once. The first chunk usually contains the headers
+// and pixels of the smaller images; the headers of any further images are
+// read individually (unless the sizes seen so far show that no further
+// image can be closer), and then only the pixels of the image closest to
+// the requested size. Each step is done for all windows at once.
+
+static constexpr uint32_t chunkLength = 8192; // in 32-bit units (32 KiB)
+static constexpr uint32_t maxImageSize = 2048;
+static constexpr int maxCachedIcons = 64;
+static constexpr int maxCachedPixelsKiB = 4096; // source pixels of icons
+
+struct IconReader
+{
+    WId window;
+    bool valid = true; // false if the window no longer exists
+    xcb_get_property_reply_t * classReply = nullptr;
+    xcb_get_property_reply_t * chunkReply = nullptr;
+
+    // all offsets and lengths are in 32-bit units
+    const uint32_t * chunk = nullptr;
+    uint32_t chunkLength = 0;
+    uint32_t totalLength = 0;
+    uint32_t next = 0; // offset of next image header
+
+    uint32_t bestOffset = 0, bestWidth = 0, bestHeight = 0;
+
+    // whether the sizes so far are in ascending or descending order
+    uint32_t lastDim = 0;
+    bool ascending = true, descending = true;
+
+    void readChunk(xcb_get_property_reply_t * reply, int size);
+    bool needHeader() const
+    {
+        return next < totalLength && next + 2 > chunkLength;
+    }
+    void addImage(uint32_t width, uint32_t height, int size);
+    bool bestInChunk() const
+    {
+        return bestOffset + 2 + bestWidth * bestHeight <= chunkLength;
+    }
+};
+
+void IconReader::readChunk(xcb_get_property_reply_t * reply, int size)
+{
+    chunkReply = reply;
+    if (!reply || reply->format != 32)
+        return;
+
+    chunk = static_cast<const uint32_t *>(xcb_get_property_value(reply));
+    chunkLength = xcb_get_property_value_length(reply) / 4;
+    totalLength = chunkLength + reply->bytes_after / 4;
+
+    while (next < totalLength && !needHeader())
+        addImage(chunk[next], chunk[next + 1], size);
+}
+
+// Prefers the smallest image at least as large as the requested size
+// (scaling down looks better than scaling up), else the largest image.
+void IconReader::addImage(uint32_t width, uint32_t height, int size)
+{
+    uint64_t end = next + 2 + (uint64_t)width * height;
+    if (width == 0 || height == 0 || width > maxImageSize ||
+        height > maxImageSize || end > totalLength)
+    {
+        next = totalLength; // invalid data, stop here
+        return;
+    }
+
+    uint32_t dim = std::max(width, height);
+    uint32_t bestDim = std::max(bestWidth, bestHeight);
+    uint32_t target = size;
+
+    if (bestDim == 0 ||
+        (dim >= target && (bestDim < target || dim < bestDim)) ||
+        (dim < target && bestDim < target && dim > bestDim))
+    {
+        bestOffset = next;
+        bestWidth = width;
+        bestHeight = height;
+        bestDim = dim;
+    }
+
+    bool sorted = false;
+    if (lastDim)
+    {
+        ascending = ascending && dim > lastDim;
+        descending = descending && dim < lastDim;
+        sorted = ascending || descending;
+    }
+
+    lastDim = dim;
+    next = end;
+
+    // Most icons list their sizes in order. Once the sizes ascend past the
+    // requested size, or descend below it, the rest can only be worse.
+    if (sorted && ((ascending && bestDim >= target) ||
+                   (descending && dim < target)))
+    {
+        next = totalLength;
+    }
+}
+
+static xcb_get_property_cookie_t requestIcon(WId window, uint32_t offset,
+                                             uint32_t length)
+{
+    return xcb_get_property(QX11Info::connection(), false, window,
+                            getX11Atom(NET_WM_ICON), XCB_ATOM_CARDINAL, offset,
+                            length);
+}
+
+static xcb_get_property_reply_t * getReply(xcb_get_property_cookie_t cookie,
+                                           bool & valid)
+{
+    xcb_generic_error_t * error = nullptr;
+    auto reply =
+        xcb_get_property_reply(QX11Info::connection(), cookie, &error);
+    if (error)
+        valid = false;
+    free(error);
+    return reply;
+}
+
+struct DecodedKey
+{
+    uint32_t width, height;
+    int size;
+    size_t hash; // of the source pixels
+
+    bool operator==(const DecodedKey & other) const
+    {
+        return width == other.width && height == other.height &&
+               size == other.size && hash == other.hash;
+    }
+};
+
+static size_t qHash(const DecodedKey & key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.width, key.height, key.size, key.hash);
+}
+
+struct DecodedIcon
+{
+    QByteArray pixels; // compared on a hit, hashes can collide
+    QIcon icon;
+};
+
+static QIcon decodeImage(const uint32_t * pixels, uint32_t width,
+                         uint32_t height, int size)
+{
+    static QCache<DecodedKey, DecodedIcon> cache(maxCachedPixelsKiB);
+
+    qsizetype bytes = qsizetype(width) * height * 4;
+    DecodedKey key{width, height, size, qHashBits(pixels, bytes)};
+    auto cached = cache.object(key);
+    if (cached && !memcmp(cached->pixels.constData(), pixels, bytes))
+        return cached->icon;
+
+    // Qt's format conversion and smooth scaling both have SIMD code paths
+    // (SSE2/AVX2/NEON). Converting also copies the pixels out of the reply.
+    QImage image((const uchar *)pixels, width, height, QImage::Format_ARGB32);
+    image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    if (std::max(width, height) != (uint32_t)size)
+        image = image.scaled(size, size, Qt::KeepAspectRatio,
+                             Qt::SmoothTransformation);
+
+    QIcon icon(QPixmap::fromImage(std::move(image)));
+    auto entry = new DecodedIcon{QByteArray((const char *)pixels, bytes), icon};
+    cache.insert(key, entry, 1 + bytes / 1024);
+    return icon;
+}
+
+static QString getClassName(xcb_get_property_reply_t * reply)
+{
+    if (!reply || reply->format != 8)
+        return QString();
+
+    // WM_CLASS contains instance and class name, separated by '\0'
+    auto data = static_cast<const char *>(xcb_get_property_value(reply));
+    int len = xcb_get_property_value_length(reply);
+    auto instanceLen = qstrnlen(data, len);
+    if ((int)instanceLen + 1 >= len)
+        return QString();
+
+    return QString::fromLatin1(data + instanceLen + 1).toLower();
+}
+
+// No usable _NET_WM_ICON; fall back to KWindowSystem (WM_HINTS icon or
+// a theme icon matching WM_CLASS), once per class and size.
+static QIcon getFallbackIcon(WId window, int size,
+                             xcb_get_property_reply_t * classReply)
+{
+    static QCache<QString, QIcon> cache(maxCachedIcons);
+
+    auto className = getClassName(classReply);
+    auto key = QString("%1/%2").arg(className).arg(size);
+
+    if (!className.isEmpty())
+    {
+        if (auto icon = cache.object(key))
+            return *icon;
+    }
+
+    countX11RoundTrip(); // at least one
+    QIcon icon = KX11Extras::icon(window, size, size, false,
+                                  KX11Extras::WMHints | KX11Extras::ClassHint |
+                                      KX11Extras::XApp);
+
+    if (!className.isEmpty())
+        cache.insert(key, new QIcon(icon));
+
+    return icon;
+}
+
+std::vector<QIcon> X11IconCache::getIcons(const QList<WId> & windows, int size)
+{
+    auto conn = QX11Info::connection();
+    std::vector<IconReader> readers(windows.size());
+    std::vector<xcb_get_property_cookie_t> cookies(windows.size());
+    std::vector<xcb_get_property_cookie_t> classCookies(windows.size());
+
+    // round trip 1: first chunk and WM_CLASS
+    for (int i = 0; i < windows.size(); i++)
+    {
+        readers[i].window = windows[i];
+        cookies[i] = requestIcon(windows[i], 0, chunkLength);
+        classCookies[i] =
+            xcb_get_property(conn, false, windows[i], XCB_ATOM_WM_CLASS,
+                             XCB_ATOM_STRING, 0, 256);
+    }
+
+    if (!windows.isEmpty())
+        countX11RoundTrip();
+
+    for (int i = 0; i < windows.size(); i++)
+    {
+        auto & reader = readers[i];
+        reader.readChunk(getReply(cookies[i], reader.valid), size);
+        reader.classReply = getReply(classCookies[i], reader.valid);
+    }
+
+    // further round trips: headers of images beyond the first chunk
+    for (bool more = true; more;)
+    {
+        more = false;
+        for (int i = 0; i < windows.size(); i++)
+        {
+            auto & reader = readers[i];
+            if (reader.valid && reader.needHeader())
+            {
+                cookies[i] = requestIcon(reader.window, reader.next, 2);
+                more = true;
+            }
+        }
+
+        if (more)
+            countX11RoundTrip();
+
+        for (int i = 0; i < windows.size(); i++)
+        {
+            auto & reader = readers[i];
+            if (!reader.valid || !reader.needHeader())
+                continue;
+
+            auto reply = getReply(cookies[i], reader.valid);
+            if (reply && reply->format == 32 &&
+                xcb_get_property_value_length(reply) == 8)
+            {
+                auto header = static_cast<const uint32_t *>(
+                    xcb_get_property_value(reply));
+                reader.addImage(header[0], header[1], size);
+            }
+            else
+                reader.next = reader.totalLength; // stop here
+
+            free(reply);
+        }
+    }
+
+    // last round trip: pixels of the best image, if not in the first chunk
+    bool needPixels = false;
+    for (int i = 0; i < windows.size(); i++)
+    {
+        auto & reader = readers[i];
+        if (reader.valid && reader.bestWidth && !reader.bestInChunk())
+        {
+            cookies[i] = requestIcon(reader.window, reader.bestOffset + 2,
+                                     reader.bestWidth * reader.bestHeight);
+            needPixels = true;
+        }
+    }
+
+    if (needPixels)
+        countX11RoundTrip();
+
+    std::vector<QIcon> icons(windows.size());
+    for (int i = 0; i < windows.size(); i++)
+    {
+        auto & reader = readers[i];
+        uint32_t count = reader.bestWidth * reader.bestHeight;
+
+        if (reader.valid && reader.bestWidth && reader.bestInChunk())
+        {
+            icons[i] = decodeImage(reader.chunk + reader.bestOffset + 2,
+                                   reader.bestWidth, reader.bestHeight, size);
+        }
+        else if (reader.valid && reader.bestWidth)
+        {
+            auto reply = getReply(cookies[i], reader.valid);
+            if (reply && reply->format == 32 &&
+                (uint32_t)xcb_get_property_value_length(reply) == count * 4)
+            {
+                auto pixels = static_cast<const uint32_t *>(
+                    xcb_get_property_value(reply));
+                icons[i] = decodeImage(pixels, reader.bestWidth,
+                                       reader.bestHeight, size);
+            }
+
+            free(reply);
+        }
+
+        if (reader.valid && icons[i].isNull())
+            icons[i] = getFallbackIcon(reader.window, size, reader.classReply);
+
+        free(reader.chunkReply);
+        free(reader.classReply);
+    }
+
+    return icons;
+}
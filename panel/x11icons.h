@@ -0,0 +1,45 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11ICONS_H
+#define X11ICONS_H
+
+#include <QIcon>
+#include <QList>
+#include <qwindowdefs.h>
+#include <vector>
+
+// Taskbar icons read from _NET_WM_ICON. Decoded icons are shared between
+// windows with identical icon data (such as many terminal windows), and
+// windows without _NET_WM_ICON share an icon per WM_CLASS.
+class X11IconCache
+{
+public:
+    // fetches the icons of all windows in a single round trip
+    static std::vector<QIcon> getIcons(const QList<WId> & windows, int size);
+};
+
+#endif // X11ICONS_H
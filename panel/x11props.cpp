@@ -0,0 +1,243 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11props.h"
+
+#include <algorithm>
+#include <private/qtx11extras_p.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+static const char * const atomNames[X11_ATOM_COUNT] = {
+    "_NET_WM_WINDOW_TYPE",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_SKIP_TASKBAR",
+    "_NET_WM_VISIBLE_NAME",
+    "_NET_WM_NAME",
+    "_NET_WM_ICON",
+    "_NET_CLIENT_LIST",
+    "_NET_CLIENT_LIST_STACKING",
+    "_NET_ACTIVE_WINDOW",
+    "UTF8_STRING"};
+
+// recognized window types follow the atoms above in getAtoms()
+static constexpr int FIRST_TYPE = X11_ATOM_COUNT;
+
+static const char * const typeNames[] = {
+    "_NET_WM_WINDOW_TYPE_NORMAL",        "_NET_WM_WINDOW_TYPE_DIALOG",
+    "_NET_WM_WINDOW_TYPE_UTILITY",       "_NET_WM_WINDOW_TYPE_DROPDOWN_MENU",
+    "_NET_WM_WINDOW_TYPE_TOOLTIP",       "_NET_WM_WINDOW_TYPE_COMBO",
+    "_NET_WM_WINDOW_TYPE_DND",           "_KDE_NET_WM_WINDOW_TYPE_OVERRIDE",
+    // types not shown in the taskbar (see ignoredTypes below)
+    "_NET_WM_WINDOW_TYPE_DESKTOP",       "_NET_WM_WINDOW_TYPE_DOCK",
+    "_NET_WM_WINDOW_TYPE_SPLASH",        "_NET_WM_WINDOW_TYPE_TOOLBAR",
+    "_NET_WM_WINDOW_TYPE_MENU",          "_KDE_NET_WM_WINDOW_TYPE_TOPMENU",
+    "_NET_WM_WINDOW_TYPE_POPUP_MENU",    "_NET_WM_WINDOW_TYPE_NOTIFICATION"};
+
+static constexpr int typeCount = sizeof typeNames / sizeof typeNames[0];
+static constexpr int ignoredTypes = 8; // index of first ignored type
+
+static quint64 roundTrips;
+
+void countX11RoundTrip() { roundTrips++; }
+quint64 getX11RoundTrips() { return roundTrips; }
+
+static const xcb_atom_t * getAtoms()
+{
+    static xcb_atom_t atoms[FIRST_TYPE + typeCount];
+    static bool interned = false;
+
+    if (!interned)
+    {
+        auto conn = QX11Info::connection();
+        xcb_intern_atom_cookie_t cookies[FIRST_TYPE + typeCount];
+
+        for (int i = 0; i < FIRST_TYPE + typeCount; i++)
+        {
+            auto name =
+                (i < FIRST_TYPE) ? atomNames[i] : typeNames[i - FIRST_TYPE];
+            cookies[i] = xcb_intern_atom(conn, false, strlen(name), name);
+        }
+
+        countX11RoundTrip();
+        for (int i = 0; i < FIRST_TYPE + typeCount; i++)
+        {
+            auto reply = xcb_intern_atom_reply(conn, cookies[i], nullptr);
+            atoms[i] = reply ? reply->atom : (xcb_atom_t)XCB_ATOM_NONE;
+            free(reply);
+        }
+
+        interned = true;
+    }
+
+    return atoms;
+}
+
+xcb_atom_t getX11Atom(X11Atom atom) { return getAtoms()[atom]; }
+
+// Same logic as KWindowInfo::windowType(): the first recognized type
+// determines whether the window is shown.
+static bool isIgnoredType(const xcb_atom_t * atoms, const xcb_atom_t * types,
+                          int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        for (int t = 0; t < typeCount; t++)
+        {
+            if (types[i] == atoms[FIRST_TYPE + t])
+                return (t >= ignoredTypes);
+        }
+    }
+
+    return false;
+}
+
+static QString getString(xcb_get_property_reply_t * reply,
+                         xcb_atom_t utf8Type)
+{
+    if (!reply || reply->format != 8)
+        return QString();
+
+    auto data = static_cast<const char *>(xcb_get_property_value(reply));
+    int len = xcb_get_property_value_length(reply);
+
+    return (reply->type == utf8Type) ? QString::fromUtf8(data, len)
+                                     : QString::fromLatin1(data, len);
+}
+
+template<typename T>
+static const T * getValues(xcb_get_property_reply_t * reply, int & count)
+{
+    if (!reply || reply->format != 32)
+    {
+        count = 0;
+        return nullptr;
+    }
+
+    count = xcb_get_property_value_length(reply) / sizeof(T);
+    return static_cast<const T *>(xcb_get_property_value(reply));
+}
+
+std::vector<X11WindowProps> X11WindowProps::fetch(const QList<WId> & windows,
+                                                  int fields)
+{
+    enum
+    {
+        TYPE,
+        STATE,
+        TRANSIENT_FOR,
+        VISIBLE_NAME,
+        NAME,
+        WM_NAME,
+        PROP_COUNT
+    };
+
+    struct Request
+    {
+        int field;
+        xcb_atom_t property;
+        uint32_t length; // in 32-bit units
+    };
+
+    auto conn = QX11Info::connection();
+    auto atoms = getAtoms();
+
+    const Request requests[PROP_COUNT] = {
+        {Type, atoms[NET_WM_WINDOW_TYPE], 32},
+        {State, atoms[NET_WM_STATE], 32},
+        {TransientFor, XCB_ATOM_WM_TRANSIENT_FOR, 1},
+        {Title, atoms[NET_WM_VISIBLE_NAME], 1024},
+        {Title, atoms[NET_WM_NAME], 1024},
+        {Title, XCB_ATOM_WM_NAME, 1024}};
+
+    // send all requests first ...
+    std::vector<xcb_get_property_cookie_t> cookies(windows.size() * PROP_COUNT);
+    for (int w = 0; w < windows.size(); w++)
+    {
+        for (int p = 0; p < PROP_COUNT; p++)
+        {
+            if (fields & requests[p].field)
+            {
+                cookies[w * PROP_COUNT + p] = xcb_get_property(
+                    conn, false, windows[w], requests[p].property,
+                    XCB_ATOM_ANY, 0, requests[p].length);
+            }
+        }
+    }
+
+    // ... then collect the replies
+    if (!windows.isEmpty() && fields)
+        countX11RoundTrip();
+
+    std::vector<X11WindowProps> result(windows.size());
+    for (int w = 0; w < windows.size(); w++)
+    {
+        auto & props = result[w];
+        xcb_get_property_reply_t * replies[PROP_COUNT] = {};
+        props.valid = true;
+
+        for (int p = 0; p < PROP_COUNT; p++)
+        {
+            if (fields & requests[p].field)
+            {
+                // an error (BadWindow) means the window is gone
+                xcb_generic_error_t * error = nullptr;
+                replies[p] = xcb_get_property_reply(
+                    conn, cookies[w * PROP_COUNT + p], &error);
+                if (error)
+                    props.valid = false;
+                free(error);
+            }
+        }
+
+        int count;
+        if (auto types = getValues<xcb_atom_t>(replies[TYPE], count))
+            props.ignoredType = isIgnoredType(atoms, types, count);
+
+        if (auto states = getValues<xcb_atom_t>(replies[STATE], count))
+        {
+            auto skip = atoms[NET_WM_STATE_SKIP_TASKBAR];
+            props.skipTaskbar =
+                (std::find(states, states + count, skip) != states + count);
+        }
+
+        auto transFor = getValues<xcb_window_t>(replies[TRANSIENT_FOR], count);
+        if (transFor && count > 0)
+            props.transientFor = transFor[0];
+
+        for (int p : {VISIBLE_NAME, NAME, WM_NAME})
+        {
+            if (props.title.isEmpty())
+                props.title = getString(replies[p], atoms[UTF8_STRING]);
+        }
+
+        for (auto reply : replies)
+            free(reply);
+    }
+
+    return result;
+}
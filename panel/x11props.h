@@ -0,0 +1,83 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11PROPS_H
+#define X11PROPS_H
+
+#include <QList>
+#include <QString>
+#include <qwindowdefs.h>
+#include <vector>
+#include <xcb/xcb.h>
+
+// Atoms used by the taskbar (interned together in a single round trip)
+enum X11Atom
+{
+    NET_WM_WINDOW_TYPE,
+    NET_WM_STATE,
+    NET_WM_STATE_SKIP_TASKBAR,
+    NET_WM_VISIBLE_NAME,
+    NET_WM_NAME,
+    NET_WM_ICON,
+    NET_CLIENT_LIST,
+    NET_CLIENT_LIST_STACKING,
+    NET_ACTIVE_WINDOW,
+    UTF8_STRING,
+    X11_ATOM_COUNT
+};
+
+xcb_atom_t getX11Atom(X11Atom atom);
+
+// Each wait for a batch of replies counts as one round trip (for --stats)
+void countX11RoundTrip();
+quint64 getX11RoundTrips();
+
+// Window properties used by the taskbar, read directly with xcb. Requests
+// for all windows and properties are sent before waiting for any reply,
+// so fetching a batch of windows costs a single round trip (whereas each
+// KWindowInfo waits for its own replies).
+struct X11WindowProps
+{
+    enum Field
+    {
+        Type = (1 << 0),         // _NET_WM_WINDOW_TYPE
+        State = (1 << 1),        // _NET_WM_STATE
+        TransientFor = (1 << 2), // WM_TRANSIENT_FOR
+        Title = (1 << 3),        // _NET_WM_VISIBLE_NAME, _NET_WM_NAME, WM_NAME
+        AllFields = Type | State | TransientFor | Title
+    };
+
+    bool valid = false;       // false if the window no longer exists
+    bool ignoredType = false; // desktop, dock, menu, etc.
+    bool skipTaskbar = false;
+    WId transientFor = 0;
+    QString title;
+
+    static std::vector<X11WindowProps> fetch(const QList<WId> & windows,
+                                             int fields);
+};
+
+#endif // X11PROPS_H
@@ -0,0 +1,86 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11screenevents.h"
+
+#include <QCoreApplication>
+#include <private/qtx11extras_p.h>
+#include <xcb/randr.h>
+
+X11ScreenEvents * X11ScreenEvents::create(std::function<void()> changed)
+{
+    auto conn = QX11Info::connection();
+    auto ext = xcb_get_extension_data(conn, &xcb_randr_id);
+    if (!ext || !ext->present)
+        return nullptr;
+
+    // Replaces the mask selected by Qt (for the same connection), so
+    // everything Qt itself selects is included.
+    xcb_randr_select_input(conn, QX11Info::appRootWindow(),
+                           XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE |
+                               XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+                               XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE |
+                               XCB_RANDR_NOTIFY_MASK_OUTPUT_PROPERTY);
+    xcb_flush(conn);
+
+    return new X11ScreenEvents(std::move(changed), ext->first_event);
+}
+
+X11ScreenEvents::X11ScreenEvents(std::function<void()> changed,
+                                 int firstEvent)
+    : mChanged(std::move(changed)), mFirstEvent(firstEvent)
+{
+    QCoreApplication::instance()->installNativeEventFilter(this);
+}
+
+X11ScreenEvents::~X11ScreenEvents()
+{
+    QCoreApplication::instance()->removeNativeEventFilter(this);
+}
+
+bool X11ScreenEvents::nativeEventFilter(const QByteArray & eventType,
+                                        void * message, qintptr *)
+{
+    if (eventType != "xcb_generic_event_t")
+        return false;
+
+    auto event = static_cast<xcb_generic_event_t *>(message);
+    int type = (event->response_type & ~0x80) - mFirstEvent;
+
+    if (type == XCB_RANDR_SCREEN_CHANGE_NOTIFY)
+        mChanged();
+    else if (type == XCB_RANDR_NOTIFY)
+    {
+        auto notify = reinterpret_cast<xcb_randr_notify_event_t *>(event);
+        if (notify->subCode == XCB_RANDR_NOTIFY_CRTC_CHANGE ||
+            notify->subCode == XCB_RANDR_NOTIFY_OUTPUT_CHANGE)
+        {
+            mChanged();
+        }
+    }
+
+    return false;
+}
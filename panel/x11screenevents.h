@@ -0,0 +1,53 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11SCREENEVENTS_H
+#define X11SCREENEVENTS_H
+
+#include <QAbstractNativeEventFilter>
+#include <functional>
+
+// Calls the handler for each RandR screen, CRTC or output change on the
+// root window. Events are taken directly from the xcb event stream, so
+// none are missed even if Qt does not update its QScreens for them.
+class X11ScreenEvents : public QAbstractNativeEventFilter
+{
+public:
+    // returns nullptr if RandR is not available
+    static X11ScreenEvents * create(std::function<void()> changed);
+    ~X11ScreenEvents();
+
+    bool nativeEventFilter(const QByteArray & eventType, void * message,
+                           qintptr * result) override;
+
+private:
+    X11ScreenEvents(std::function<void()> changed, int firstEvent);
+
+    std::function<void()> mChanged;
+    int const mFirstEvent;
+};
+
+#endif // X11SCREENEVENTS_H
@@ -0,0 +1,354 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11tasks.h"
+#include "x11events.h"
+#include "x11icons.h"
+#include "x11props.h"
+#include "x11thumbnails.h"
+
+#include <KX11Extras>
+#include <QApplication>
+#include <QScreen>
+#include <QStyle>
+#include <QtMath>
+#include <private/qtx11extras_p.h>
+
+X11Tasks::X11Tasks(TaskModel & model) : mModel(model)
+{
+    mUpdateTimer.setSingleShot(true);
+    QObject::connect(&mUpdateTimer, &QTimer::timeout,
+                     [this]() { flushUpdates(); });
+
+    if (X11EventFilter::isEnabled())
+    {
+        mEventFilter.reset(new X11EventFilter({
+            [this](WId window) { onWindowAdded(window); },
+            [this](WId window) { onWindowRemoved(window); },
+            [this](WId window) {
+                mModel.setEventTime(TaskModel::now());
+                onActiveWindowChanged(window);
+            },
+            [this](WId window, NET::Properties prop, NET::Properties2 prop2) {
+                onWindowChanged(window, prop, prop2);
+            },
+        }));
+
+        mActiveWindow = mEventFilter->activeWindow();
+        addWindows(mEventFilter->stackingOrder());
+    }
+    else
+    {
+        mActiveWindow = KX11Extras::activeWindow();
+        addWindows(KX11Extras::stackingOrder());
+
+        auto kx11 = KX11Extras::self();
+        mConnections[0] =
+            QObject::connect(kx11, &KX11Extras::windowAdded,
+                             [this](WId window) { onWindowAdded(window); });
+        mConnections[1] =
+            QObject::connect(kx11, &KX11Extras::windowRemoved,
+                             [this](WId window) { onWindowRemoved(window); });
+        mConnections[2] = QObject::connect(
+            kx11, &KX11Extras::activeWindowChanged, [this](WId window) {
+                mModel.setEventTime(TaskModel::now());
+                onActiveWindowChanged(window);
+            });
+        mConnections[3] = QObject::connect(
+            kx11, &KX11Extras::windowChanged,
+            [this](WId window, NET::Properties prop, NET::Properties2 prop2) {
+                onWindowChanged(window, prop, prop2);
+            });
+    }
+}
+
+X11Tasks::~X11Tasks()
+{
+    for (auto & connection : mConnections)
+        QObject::disconnect(connection);
+}
+
+void X11Tasks::activate(TaskModel::Id id)
+{
+    KX11Extras::forceActiveWindow(id);
+    // need to flush if called from timer
+    xcb_flush(QX11Info::connection());
+}
+
+void X11Tasks::minimize(TaskModel::Id id) { KX11Extras::minimizeWindow(id); }
+
+void X11Tasks::close(TaskModel::Id id)
+{
+    NETRootInfo info(QX11Info::connection(), NET::CloseWindow);
+    info.closeWindowRequest(id);
+}
+
+X11Thumbnails * X11Tasks::thumbnails()
+{
+    // created on first use (not at all with TaskBarMode=strip)
+    if (!mThumbnailsChecked)
+    {
+        mThumbnails = X11Thumbnails::create();
+        mThumbnailsChecked = true;
+    }
+
+    return mThumbnails.get();
+}
+
+bool X11Tasks::acceptWindow(WId window, const X11WindowProps & props)
+{
+    if (!props.valid || props.ignoredType || props.skipTaskbar)
+        return false;
+
+    WId transFor = props.transientFor;
+    if (transFor == 0 || transFor == window ||
+        transFor == (WId)QX11Info::appRootWindow())
+    {
+        return true;
+    }
+
+    return false;
+}
+
+void X11Tasks::addWindows(const QList<WId> & windows)
+{
+    QList<WId> added;
+    mModel.setEventTime(TaskModel::now());
+    auto props = X11WindowProps::fetch(windows, X11WindowProps::AllFields);
+    for (int i = 0; i < windows.size(); i++)
+    {
+        if (acceptWindow(windows[i], props[i]) &&
+            addWindow(windows[i], props[i]))
+            added.append(windows[i]);
+        setTransientFor(windows[i], props[i]);
+    }
+
+    updateIcons(added);
+    onActiveWindowChanged(mActiveWindow);
+}
+
+void X11Tasks::setTransientFor(WId window, const X11WindowProps & props)
+{
+    if (props.valid && props.transientFor)
+        mTransientFor[window] = props.transientFor;
+    else
+        mTransientFor.erase(window);
+}
+
+bool X11Tasks::addWindow(WId window, const X11WindowProps & props)
+{
+    if (mModel.contains(window))
+        return false;
+
+    mModel.add(window);
+    mModel.setTitle(window, props.title);
+    return true;
+}
+
+// updates (if given) holds the event time of each window
+void X11Tasks::updateIcons(const QList<WId> & windows,
+                           const QueuedUpdates * updates)
+{
+    if (windows.isEmpty())
+        return;
+
+    // fetch enough pixels for a fractional scale (rather than rounding down)
+    int size = qCeil(QApplication::style()->pixelMetric(
+                         QStyle::PM_ToolBarIconSize) *
+                     qApp->devicePixelRatio());
+
+    auto icons = X11IconCache::getIcons(windows, size);
+    for (int i = 0; i < windows.size(); i++)
+    {
+        if (mModel.contains(windows[i]))
+        {
+#ifdef QMPANEL_BENCH
+            if (updates)
+                mModel.setEventTime(updates->at(windows[i]).eventTime);
+#endif
+            mModel.setIcon(windows[i], icons[i]);
+        }
+    }
+}
+
+void X11Tasks::removeWindow(WId window)
+{
+    if (mQueuedUpdates.erase(window))
+        mQueuedWindows.removeOne(window);
+
+    if (mActiveTask == window)
+        mActiveTask = 0;
+    if (mThumbnails)
+        mThumbnails->forgetWindow(window);
+
+    mModel.remove(window);
+}
+
+void X11Tasks::onWindowAdded(WId window)
+{
+    if (!mModel.contains(window))
+        queueUpdate(window, CheckAccept);
+}
+
+void X11Tasks::onWindowRemoved(WId window)
+{
+    mTransientFor.erase(window);
+    removeWindow(window);
+}
+
+// Focus changes are the most common event, so only the previously and
+// newly active tasks are touched, and no X11 requests are made.
+void X11Tasks::onActiveWindowChanged(WId window)
+{
+    mActiveWindow = window;
+
+    // for dialogs (not shown in the taskbar), check the main window
+    WId task = 0;
+    if (mModel.contains(window))
+        task = window;
+    else
+    {
+        auto transient = mTransientFor.find(window);
+        if (transient != mTransientFor.end() &&
+            mModel.contains(transient->second))
+        {
+            task = transient->second;
+        }
+    }
+
+    if (mActiveTask && mActiveTask != task)
+        mModel.setStates(mActiveTask, 0);
+    if (task)
+        mModel.setStates(task, TaskModel::Active);
+
+    mActiveTask = task;
+}
+
+void X11Tasks::onWindowChanged(WId window, NET::Properties prop,
+                               NET::Properties2 prop2)
+{
+    int flags = 0;
+    if (prop.testFlag(NET::WMWindowType) || prop.testFlag(NET::WMState) ||
+        prop2.testFlag(NET::WM2TransientFor))
+        flags |= CheckAccept;
+    if (prop.testFlag(NET::WMVisibleName) || prop.testFlag(NET::WMName))
+        flags |= UpdateTitle;
+    if (prop.testFlag(NET::WMIcon))
+        flags |= UpdateIcon;
+
+    // unknown windows only matter if they might now be accepted
+    if (!(flags & CheckAccept) && !mModel.contains(window))
+        return;
+
+    if (flags)
+        queueUpdate(window, flags);
+}
+
+// Some windows change their title (or icon) many times per second. Each
+// change only sets a flag here; the X server is queried at most once per
+// frame, for all queued windows at once.
+void X11Tasks::queueUpdate(WId window, int flags)
+{
+    auto & stats = mModel.stats();
+    stats.events++;
+
+    auto & queued = mQueuedUpdates[window];
+    if (queued.flags)
+        stats.merged++;
+    else
+    {
+#ifdef QMPANEL_BENCH
+        queued.eventTime = TaskModel::now();
+#endif
+        mQueuedWindows.append(window);
+    }
+
+    queued.flags |= flags;
+
+    if (!mUpdateTimer.isActive())
+    {
+        auto screen = QGuiApplication::primaryScreen();
+        qreal rate = screen ? screen->refreshRate() : 60;
+        int frame = 1000 / std::max(rate, qreal(1));
+        int wait = mLastFlush.isValid() ? frame - mLastFlush.elapsed() : 0;
+        mUpdateTimer.start(std::max(wait, 0));
+    }
+}
+
+void X11Tasks::flushUpdates()
+{
+    QList<WId> windows;
+    QueuedUpdates updates;
+    windows.swap(mQueuedWindows);
+    updates.swap(mQueuedUpdates);
+
+    mLastFlush.start();
+    mModel.stats().flushes++;
+
+    int fields = 0;
+    for (auto & pair : updates)
+    {
+        if (pair.second.flags & CheckAccept)
+            fields |= X11WindowProps::AllFields;
+        if (pair.second.flags & UpdateTitle)
+            fields |= X11WindowProps::Title;
+    }
+
+    QList<WId> iconWindows;
+    auto props = X11WindowProps::fetch(windows, fields);
+    for (int i = 0; i < windows.size(); i++)
+    {
+        WId window = windows[i];
+        int flags = updates[window].flags;
+#ifdef QMPANEL_BENCH
+        mModel.setEventTime(updates[window].eventTime);
+#endif
+
+        if (flags & CheckAccept)
+        {
+            if (!acceptWindow(window, props[i]))
+                removeWindow(window);
+            else if (addWindow(window, props[i]))
+                flags |= UpdateIcon;
+
+            setTransientFor(window, props[i]);
+        }
+
+        if (!mModel.contains(window))
+            continue;
+
+        if (flags & UpdateTitle)
+            mModel.setTitle(window, props[i].title);
+        if (flags & UpdateIcon)
+            iconWindows.append(window);
+    }
+
+    // icons of all windows are fetched in a second round trip
+    updateIcons(iconWindows, &updates);
+
+    // the active window may have been added or become a transient
+    onActiveWindowChanged(mActiveWindow);
+}
@@ -0,0 +1,103 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11TASKS_H
+#define X11TASKS_H
+
+#include "taskmodel.h"
+
+#include <NETWM>
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+#include <memory>
+#include <unordered_map>
+
+class X11EventFilter;
+class X11Thumbnails;
+struct X11WindowProps;
+
+// X11 backend for TaskModel, fed either by KX11Extras or X11EventFilter
+class X11Tasks : public TaskModel::Backend
+{
+public:
+    explicit X11Tasks(TaskModel & model);
+    ~X11Tasks();
+
+    void activate(TaskModel::Id id) override;
+    void minimize(TaskModel::Id id) override;
+    void close(TaskModel::Id id) override;
+    X11Thumbnails * thumbnails() override;
+
+private:
+    enum UpdateFlag
+    {
+        CheckAccept = (1 << 0), // window added or type/state changed
+        UpdateTitle = (1 << 1),
+        UpdateIcon = (1 << 2)
+    };
+
+    struct QueuedUpdate
+    {
+        int flags = 0;
+#ifdef QMPANEL_BENCH
+        qint64 eventTime = 0; // of the first event merged into the update
+#endif
+    };
+
+    using QueuedUpdates = std::unordered_map<WId, QueuedUpdate>;
+
+    static bool acceptWindow(WId window, const X11WindowProps & props);
+    void addWindows(const QList<WId> & windows);
+    bool addWindow(WId window, const X11WindowProps & props);
+    void updateIcons(const QList<WId> & windows,
+                     const QueuedUpdates * updates = nullptr);
+    void setTransientFor(WId window, const X11WindowProps & props);
+    void removeWindow(WId window);
+    void onWindowAdded(WId window);
+    void onWindowRemoved(WId window);
+    void onActiveWindowChanged(WId window);
+    void onWindowChanged(WId window, NET::Properties prop,
+                         NET::Properties2 prop2);
+    void queueUpdate(WId window, int flags);
+    void flushUpdates();
+
+    TaskModel & mModel;
+    std::unique_ptr<X11EventFilter> mEventFilter;
+    std::unordered_map<WId, WId> mTransientFor; // for unknown windows too
+    WId mActiveWindow = 0;
+    WId mActiveTask = 0; // the active window or its main window
+    QueuedUpdates mQueuedUpdates;
+    QList<WId> mQueuedWindows; // in order queued
+    QTimer mUpdateTimer;
+    QElapsedTimer mLastFlush;
+    QMetaObject::Connection mConnections[4];
+    // one per process, since each redirects windows and filters events
+    std::unique_ptr<X11Thumbnails> mThumbnails;
+    bool mThumbnailsChecked = false;
+};
+
+#endif // X11TASKS_H
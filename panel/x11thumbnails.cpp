@@ -0,0 +1,379 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#include "x11thumbnails.h"
+
+#include <QCoreApplication>
+#include <QScreen>
+#include <algorithm>
+#include <private/qtx11extras_p.h>
+#include <stdlib.h>
+#include <xcb/composite.h>
+#include <xcb/damage.h>
+
+static constexpr int maxThumbnailSize = 256; // logical pixels
+static constexpr int minRefreshInterval = 100; // ms
+static constexpr int releaseDelay = 3000;      // ms
+
+static xcb_render_fixed_t toFixed(double value)
+{
+    return (xcb_render_fixed_t)(value * 65536);
+}
+
+std::unique_ptr<X11Thumbnails> X11Thumbnails::create()
+{
+    auto conn = QX11Info::connection();
+    xcb_prefetch_extension_data(conn, &xcb_composite_id);
+    xcb_prefetch_extension_data(conn, &xcb_damage_id);
+    xcb_prefetch_extension_data(conn, &xcb_render_id);
+
+    auto composite = xcb_get_extension_data(conn, &xcb_composite_id);
+    auto damage = xcb_get_extension_data(conn, &xcb_damage_id);
+    auto render = xcb_get_extension_data(conn, &xcb_render_id);
+
+    if (!composite || !composite->present || !damage || !damage->present ||
+        !render || !render->present)
+    {
+        return nullptr;
+    }
+
+    // the version queries are required before using each extension
+    auto compositeCookie = xcb_composite_query_version(conn, 0, 2);
+    auto damageCookie = xcb_damage_query_version(conn, 1, 1);
+    auto formatsCookie = xcb_render_query_pict_formats(conn);
+
+    auto compositeReply =
+        xcb_composite_query_version_reply(conn, compositeCookie, nullptr);
+    auto damageReply =
+        xcb_damage_query_version_reply(conn, damageCookie, nullptr);
+    auto formatsReply =
+        xcb_render_query_pict_formats_reply(conn, formatsCookie, nullptr);
+
+    std::unique_ptr<X11Thumbnails> thumbnails;
+    // NameWindowPixmap was added in Composite 0.2
+    if (compositeReply && damageReply && formatsReply &&
+        (compositeReply->major_version > 0 ||
+         compositeReply->minor_version >= 2))
+    {
+        thumbnails.reset(
+            new X11Thumbnails(damage->first_event, formatsReply));
+        if (!thumbnails->mArgbFormat)
+            thumbnails.reset();
+    }
+
+    free(compositeReply);
+    free(damageReply);
+    free(formatsReply);
+    return thumbnails;
+}
+
+X11Thumbnails::X11Thumbnails(uint8_t damageEvent,
+                             xcb_render_query_pict_formats_reply_t * formats)
+    : mDamageEvent(damageEvent), mPopup(nullptr, Qt::ToolTip),
+      mLayout(&mPopup)
+{
+    auto format = xcb_render_query_pict_formats_formats_iterator(formats);
+    for (; format.rem; xcb_render_pictforminfo_next(&format))
+    {
+        auto & info = *format.data;
+        if (info.type == XCB_RENDER_PICT_TYPE_DIRECT && info.depth == 32 &&
+            info.direct.alpha_shift == 24 && info.direct.alpha_mask == 0xff &&
+            info.direct.red_shift == 16 && info.direct.red_mask == 0xff &&
+            info.direct.green_shift == 8 && info.direct.green_mask == 0xff &&
+            info.direct.blue_shift == 0 && info.direct.blue_mask == 0xff)
+        {
+            mArgbFormat = info.id;
+            break;
+        }
+    }
+
+    auto screen = xcb_render_query_pict_formats_screens_iterator(formats);
+    for (; screen.rem; xcb_render_pictscreen_next(&screen))
+    {
+        auto depth = xcb_render_pictscreen_depths_iterator(screen.data);
+        for (; depth.rem; xcb_render_pictdepth_next(&depth))
+        {
+            auto visual = xcb_render_pictdepth_visuals_iterator(depth.data);
+            for (; visual.rem; xcb_render_pictvisual_next(&visual))
+                mFormats[visual.data->visual] = visual.data->format;
+        }
+    }
+
+    mLayout.addWidget(&mImageLabel);
+    mLayout.addWidget(&mTitleLabel);
+    mImageLabel.setAlignment(Qt::AlignCenter);
+    mTitleLabel.setAlignment(Qt::AlignCenter);
+    mTitleLabel.setTextFormat(Qt::PlainText);
+
+    mRefreshTimer.setSingleShot(true);
+    QObject::connect(&mRefreshTimer, &QTimer::timeout, [this]() { refresh(); });
+
+    mReleaseTimer.setSingleShot(true);
+    mReleaseTimer.setInterval(releaseDelay);
+    QObject::connect(&mReleaseTimer, &QTimer::timeout,
+                     [this]() { releaseHidden(); });
+
+    QCoreApplication::instance()->installNativeEventFilter(this);
+}
+
+X11Thumbnails::~X11Thumbnails()
+{
+    QCoreApplication::instance()->removeNativeEventFilter(this);
+
+    while (!mThumbnails.empty())
+        forgetWindow(mThumbnails.begin()->first);
+}
+
+bool X11Thumbnails::showPreview(WId window, const QString & title,
+                                QWidget * anchor)
+{
+    mShownWindow = window;
+    mMaxSize = QSize(maxThumbnailSize, maxThumbnailSize) *
+               anchor->devicePixelRatioF();
+
+    refresh();
+    if (mImageLabel.pixmap().isNull())
+    {
+        mShownWindow = 0;
+        return false;
+    }
+
+    mTitleLabel.setText(title);
+    mTitleLabel.setMaximumWidth(maxThumbnailSize);
+    mPopup.adjustSize();
+
+    // open upward from the panel, but keep within the screen
+    QPoint pos = anchor->mapToGlobal(QPoint(0, -mPopup.height()));
+    QRect screen = anchor->screen()->geometry();
+    pos.rx() = std::max(screen.left(),
+                        std::min(pos.x(), screen.right() + 1 - mPopup.width()));
+
+    mPopup.move(pos);
+    mPopup.show();
+    return true;
+}
+
+void X11Thumbnails::hidePreview()
+{
+    mShownWindow = 0;
+    mRefreshTimer.stop();
+    mPopup.hide();
+    mImageLabel.clear();
+    mReleaseTimer.start();
+}
+
+void X11Thumbnails::forgetWindow(WId window)
+{
+    if (window == mShownWindow)
+        hidePreview();
+
+    auto pos = mThumbnails.find(window);
+    if (pos == mThumbnails.end())
+        return;
+
+    releaseWindow(window, pos->second);
+    mThumbnails.erase(pos);
+}
+
+// Stops redirecting the window, which frees its offscreen pixmap. The
+// thumbnail is rendered again the next time it is shown.
+void X11Thumbnails::releaseWindow(WId window, Thumbnail & thumb)
+{
+    if (!thumb.damage)
+        return;
+
+    // the window (and with it the damage object) may already be gone,
+    // so any errors are discarded
+    auto conn = QX11Info::connection();
+    auto cookie = xcb_damage_destroy_checked(conn, thumb.damage);
+    xcb_discard_reply(conn, cookie.sequence);
+    cookie = xcb_composite_unredirect_window_checked(
+        conn, window, XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+    xcb_discard_reply(conn, cookie.sequence);
+
+    thumb.damage = 0;
+    thumb.dirty = true;
+}
+
+void X11Thumbnails::releaseHidden()
+{
+    for (auto & pair : mThumbnails)
+    {
+        if (pair.first != mShownWindow)
+            releaseWindow(pair.first, pair.second);
+    }
+}
+
+bool X11Thumbnails::nativeEventFilter(const QByteArray & eventType,
+                                      void * message, qintptr *)
+{
+    if (eventType != "xcb_generic_event_t")
+        return false;
+
+    auto event = static_cast<xcb_generic_event_t *>(message);
+    if ((event->response_type & ~0x80) != mDamageEvent + XCB_DAMAGE_NOTIFY)
+        return false;
+
+    auto notify = reinterpret_cast<xcb_damage_notify_event_t *>(event);
+    auto pos = mThumbnails.find(notify->drawable);
+    if (pos == mThumbnails.end())
+        return false;
+
+    // with ReportNonEmpty, there is only one event until the next refresh
+    pos->second.dirty = true;
+
+    if (notify->drawable == mShownWindow && !mRefreshTimer.isActive())
+    {
+        int elapsed = mLastRefresh.isValid() ? mLastRefresh.elapsed()
+                                             : minRefreshInterval;
+        mRefreshTimer.start(std::max(0, minRefreshInterval - elapsed));
+    }
+
+    return true;
+}
+
+// Renders a scaled-down copy of the window entirely on the server side
+// and reads back only the result.
+QImage X11Thumbnails::render(WId window, QSize maxSize)
+{
+    auto conn = QX11Info::connection();
+    auto attrCookie = xcb_get_window_attributes(conn, window);
+    auto geomCookie = xcb_get_geometry(conn, window);
+
+    auto attr = xcb_get_window_attributes_reply(conn, attrCookie, nullptr);
+    auto geom = xcb_get_geometry_reply(conn, geomCookie, nullptr);
+
+    xcb_render_pictformat_t format = 0;
+    bool viewable = attr && attr->map_state == XCB_MAP_STATE_VIEWABLE;
+    int width = geom ? geom->width : 0;
+    int height = geom ? geom->height : 0;
+
+    if (attr)
+    {
+        auto pos = mFormats.find(attr->visual);
+        if (pos != mFormats.end())
+            format = pos->second;
+    }
+
+    free(attr);
+    free(geom);
+
+    // unmapped windows have no contents
+    if (!viewable || !format || width <= 0 || height <= 0)
+        return QImage();
+
+    xcb_pixmap_t pixmap = xcb_generate_id(conn);
+    auto error = xcb_request_check(
+        conn, xcb_composite_name_window_pixmap_checked(conn, window, pixmap));
+
+    if (error)
+    {
+        free(error);
+        return QImage();
+    }
+
+    double scale = std::max({width / (double)maxSize.width(),
+                             height / (double)maxSize.height(), 1.0});
+    int thumbWidth = std::max((int)(width / scale), 1);
+    int thumbHeight = std::max((int)(height / scale), 1);
+
+    xcb_render_picture_t source = xcb_generate_id(conn);
+    xcb_render_create_picture(conn, source, pixmap, format, 0, nullptr);
+
+    // maps destination pixels to source pixels
+    xcb_render_transform_t transform = {
+        toFixed(scale), 0, 0, 0, toFixed(scale), 0, 0, 0, toFixed(1)};
+    xcb_render_set_picture_transform(conn, source, transform);
+    xcb_render_set_picture_filter(conn, source, 4, "good", 0, nullptr);
+
+    xcb_pixmap_t thumbPixmap = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, 32, thumbPixmap, QX11Info::appRootWindow(),
+                      thumbWidth, thumbHeight);
+
+    xcb_render_picture_t dest = xcb_generate_id(conn);
+    xcb_render_create_picture(conn, dest, thumbPixmap, mArgbFormat, 0,
+                              nullptr);
+
+    xcb_render_composite(conn, XCB_RENDER_PICT_OP_SRC, source, XCB_NONE, dest,
+                         0, 0, 0, 0, 0, 0, thumbWidth, thumbHeight);
+
+    auto imageCookie =
+        xcb_get_image(conn, XCB_IMAGE_FORMAT_Z_PIXMAP, thumbPixmap, 0, 0,
+                      thumbWidth, thumbHeight, ~0u);
+
+    xcb_render_free_picture(conn, dest);
+    xcb_render_free_picture(conn, source);
+    xcb_free_pixmap(conn, thumbPixmap);
+    xcb_free_pixmap(conn, pixmap);
+
+    QImage image;
+    auto reply = xcb_get_image_reply(conn, imageCookie, nullptr);
+    if (reply && reply->depth == 32 &&
+        xcb_get_image_data_length(reply) >= thumbWidth * thumbHeight * 4)
+    {
+        image = QImage(xcb_get_image_data(reply), thumbWidth, thumbHeight,
+                       thumbWidth * 4, QImage::Format_ARGB32_Premultiplied)
+                    .copy();
+    }
+
+    free(reply);
+    return image;
+}
+
+void X11Thumbnails::refresh()
+{
+    if (!mShownWindow)
+        return;
+
+    auto conn = QX11Info::connection();
+    auto & thumb = mThumbnails[mShownWindow];
+
+    if (!thumb.damage)
+    {
+        // without a compositing window manager, windows are drawn directly
+        // to the screen and have no pixmap of their own to read from
+        xcb_composite_redirect_window(conn, mShownWindow,
+                                      XCB_COMPOSITE_REDIRECT_AUTOMATIC);
+
+        thumb.damage = xcb_generate_id(conn);
+        xcb_damage_create(conn, thumb.damage, mShownWindow,
+                          XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+    }
+
+    if (thumb.dirty || thumb.maxSize != mMaxSize)
+    {
+        // subtract first so that changes while rendering are reported
+        xcb_damage_subtract(conn, thumb.damage, XCB_NONE, XCB_NONE);
+        thumb.image = render(mShownWindow, mMaxSize);
+        thumb.maxSize = mMaxSize;
+        thumb.dirty = thumb.image.isNull(); // try again next time
+        mLastRefresh.start();
+    }
+
+    QPixmap pixmap = QPixmap::fromImage(thumb.image);
+    pixmap.setDevicePixelRatio(mMaxSize.width() / (qreal)maxThumbnailSize);
+    mImageLabel.setPixmap(pixmap);
+}
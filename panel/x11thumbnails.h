@@ -0,0 +1,94 @@
+/* BEGIN_COMMON_COPYRIGHT_HEADER
+ * (c)LGPL2+
+ *
+ * qmpanel - a minimal Qt-based desktop panel
+ *
+ * Copyright: 2024 John Lindgren
+ * Authors:
+ *   John Lindgren <john@jlindgren.net>
+ *
+ * This program or library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ *
+ * END_COMMON_COPYRIGHT_HEADER */
+
+#ifndef X11THUMBNAILS_H
+#define X11THUMBNAILS_H
+
+#include <QAbstractNativeEventFilter>
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <memory>
+#include <unordered_map>
+#include <xcb/render.h>
+
+// Hover previews for X11 task buttons. Thumbnails are scaled down by the
+// X server (Composite + Render), so only thumbnail-sized images are ever
+// copied to the panel. While a preview is shown, the thumbnail is
+// re-rendered only after a Damage event, at most 10 times per second.
+// Windows are redirected (and tracked with Damage) only while their
+// preview is shown and for a few seconds after, to keep moving between
+// task buttons cheap; then only the scaled image is kept.
+class X11Thumbnails : public QAbstractNativeEventFilter
+{
+public:
+    // returns null if the required extensions are missing
+    static std::unique_ptr<X11Thumbnails> create();
+
+    ~X11Thumbnails();
+
+    // returns false if there is nothing to preview (e.g. minimized)
+    bool showPreview(WId window, const QString & title, QWidget * anchor);
+    void hidePreview();
+    void forgetWindow(WId window);
+
+    bool nativeEventFilter(const QByteArray & eventType, void * message,
+                           qintptr * result) override;
+
+private:
+    struct Thumbnail
+    {
+        uint32_t damage = 0;
+        bool dirty = true;
+        QSize maxSize;
+        QImage image;
+    };
+
+    X11Thumbnails(uint8_t damageEvent,
+                  xcb_render_query_pict_formats_reply_t * formats);
+
+    QImage render(WId window, QSize maxSize);
+    void refresh();
+    void releaseWindow(WId window, Thumbnail & thumb);
+    void releaseHidden();
+
+    uint8_t mDamageEvent;
+    xcb_render_pictformat_t mArgbFormat = 0;
+    std::unordered_map<xcb_visualid_t, xcb_render_pictformat_t> mFormats;
+    std::unordered_map<WId, Thumbnail> mThumbnails;
+    WId mShownWindow = 0;
+    QSize mMaxSize;
+
+    QWidget mPopup;
+    QVBoxLayout mLayout;
+    QLabel mImageLabel, mTitleLabel;
+    QTimer mRefreshTimer;
+    QTimer mReleaseTimer;
+    QElapsedTimer mLastRefresh;
+};
+
+#endif // X11THUMBNAILS_H